@@ -0,0 +1,56 @@
+"""Compare `plyr.apply` with and without the plan cache.
+
+    python benchmarks/bench_cache.py
+"""
+from collections import namedtuple
+from timeit import timeit
+
+import plyr
+
+Transition = namedtuple("Transition", "obs act rew fin")
+
+
+def structures():
+    yield "flat list (8)", list(range(8))
+    yield "dict of 16", {f"k{j}": j for j in range(16)}
+    yield "nested (64 leaves)", {
+        "actor": [Transition(j, j, 0.0, False) for j in range(8)],
+        "critic": {f"layer{j}": (j, [j, j]) for j in range(8)},
+        "meta": (1, 2, 3, 4, 5, 6, 7, 8),
+    }
+    yield "deep (32 levels)", (lambda d: [d])(
+        eval("[" * 32 + "0" + "]" * 32)
+    )
+
+
+def main(number=20000, rounds=25):
+    print(f"{'structure':32s} {'apply':>10s} {'_cache':>10s} {'speedup':>8s}")
+    for (name, obj), n_objects in [
+        (item, n) for n in (1, 2) for item in structures()
+    ]:
+        # the other objects are validated against the first one
+        objects = [obj] * n_objects
+        f = id if n_objects == 1 else max
+        name = f"{name} x{n_objects}"
+
+        def plain():
+            plyr.apply(f, *objects)
+
+        def cached():
+            plyr.apply(f, *objects, _cache=True)
+
+        # the rounds are interleaved against the drift of the clock, and the
+        #  cache is warmed up by the first one
+        t_plain, t_cached = float("inf"), float("inf")
+        for _ in range(rounds):
+            t_plain = min(t_plain, timeit(plain, number=number) / number)
+            t_cached = min(t_cached, timeit(cached, number=number) / number)
+
+        print(
+            f"{name:32s} {t_plain * 1e6:8.2f}us {t_cached * 1e6:8.2f}us "
+            f"{t_plain / t_cached:7.2f}x"
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,40 @@
+"""Measure the per-call overhead of the entry points on small inputs.
+
+    python benchmarks/bench_calls.py
+"""
+from timeit import timeit
+
+import plyr
+
+
+def inputs():
+    yield "1 leaf", 0
+    yield "10 leaves", [0, (1, 2), {"a": 3, "b": [4, 5]}, 6, 7, (8, 9)]
+
+
+def calls(obj):
+    flat, skel = plyr.flatten(obj)
+    yield "apply", lambda: plyr.apply(id, obj)
+    yield "apply x2", lambda: plyr.apply(max, obj, obj)
+    yield "apply _star=False", lambda: plyr.apply(id, obj, _star=False)
+    yield "apply kwargs", lambda: plyr.apply(round, obj, ndigits=1)
+    yield "ragged x2", lambda: plyr.ragged(max, obj, 1)
+    yield "suply", lambda: plyr.suply(id, obj)
+    yield "tuply", lambda: plyr.tuply(id, obj)
+    yield "s_ply", lambda: plyr.s_ply(id, obj)
+    yield "t_ply", lambda: plyr.t_ply(id, obj)
+    yield "populate", lambda: plyr.populate(skel, flat)
+    yield "validate x2", lambda: plyr.validate(obj, obj)
+
+
+def main(number=50000, rounds=15):
+    for name, obj in inputs():
+        print(f"{name}:")
+        for call, fn in calls(obj):
+            # the best of the rounds is the least disturbed by the machine
+            best = min(timeit(fn, number=number) for _ in range(rounds))
+            print(f"    {call:24s} {best / number * 1e6:8.3f}us")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,15 @@
 """Streamlined operations on built-in nested containers."""
+from functools import partial
+
 from .__version__ import __version__
 
 from .base import (
     apply,
     flatapply,
+    multiapply,
+    chainapply,
+    transpose,
+    untranspose,
     validate,
     ragged,
     suply,
@@ -16,11 +22,71 @@ from .base import (
     xsetitem,
     identity,
     populate,
+    reduce,
     AtomicTuple,
     AtomicList,
     AtomicDict,
+    TreeDef,
+)
+
+from . import ops
+from .ops import (
+    reduce_norm,
+    dot,
+    sum,
+    max,
+    stack,
+    concatenate,
+    take,
+    put,
+    pack,
+    unpack,
+    unflatten_buffer,
+    RingBuffer,
 )
 
+# `sum`, `max` and `reduce` are left out of the star-import, since they would
+#  shadow the builtins and `functools.reduce`, use `plyr.sum` etc. instead
+__all__ = [
+    "apply",
+    "flatapply",
+    "multiapply",
+    "chainapply",
+    "transpose",
+    "untranspose",
+    "validate",
+    "ragged",
+    "suply",
+    "tuply",
+    "s_ply",
+    "t_ply",
+    "getitem",
+    "setitem",
+    "xgetitem",
+    "xsetitem",
+    "identity",
+    "populate",
+    "AtomicTuple",
+    "AtomicList",
+    "AtomicDict",
+    "TreeDef",
+    "ops",
+    "reduce_norm",
+    "dot",
+    "stack",
+    "concatenate",
+    "take",
+    "put",
+    "pack",
+    "unpack",
+    "unflatten_buffer",
+    "RingBuffer",
+    "flatten",
+    "unflatten",
+    "iapply",
+    "lazy",
+]
+
 
 def flatten(struct):
     """Get a flat depth-first representation of the nested object.
@@ -64,11 +130,15 @@ def unflatten(flat, struct, *, raises=True):
     Raises `StopItertaion` if the iterable is exhausted before the structure is
     completely rebuilt. Data consumed by an unsuccessful `unflatten` is LOST.
     """
+    # lists and tuples are read by position, other iterables by an iterator
+    if not isinstance(flat, (list, tuple)):
+        flat = iter(flat)
+
     # use `next(it, None)` to fill missing leaves with `None`-s.
     if not raises:
-        return populate(struct, iter(flat), default=None)
+        return populate(struct, flat, default=None)
 
-    return populate(struct, iter(flat))
+    return populate(struct, flat)
 
 
 def iapply(f, *objects, _star=True, **kwargs):
@@ -105,3 +175,56 @@ def iapply(f, *objects, _star=True, **kwargs):
         return None
 
     return apply(unflatten, *flat, _star=False, struct=struct)
+
+
+class lazy:
+    """A deferred chain of `apply`-s on the nested objects.
+
+    Parameters
+    ----------
+    *objects : nested objects
+        The nested objects, leaves of which supply arguments for the first
+        stage of the pipeline.
+
+    _safe, _star, _strict : bool, default=True
+        See `.apply`.
+
+    Details
+    -------
+    The stages added by `.map` are recorded, and `.compute` walks the nested
+    objects once, computing the stages one after another on each leaf, so
+
+    >>> lazy(x).map(f1).map(f2).map(f3).compute()
+
+    equals `apply(f3, apply(f2, apply(f1, x)))`, but builds no intermediate
+    nested objects. `.map` returns a new pipeline, hence pipelines may share
+    their first stages.
+    """
+    __slots__ = "objects", "stages", "options"
+
+    def __init__(self, *objects, _safe=True, _star=True, _strict=True):
+        if not objects:
+            raise TypeError("lazy() takes at least 1 argument (0 given)")
+
+        self.objects, self.stages = objects, ()
+        self.options = dict(_safe=_safe, _star=_star, _strict=_strict)
+
+    def map(self, f, **kwargs):
+        """Add the stage, that computes `f` on the results of the previous
+        stage, or on the leaf data of the objects, if it is the first one.
+        """
+        if not callable(f):
+            raise TypeError("The stage must be a callable.")
+
+        pipeline = object.__new__(type(self))
+        pipeline.objects, pipeline.options = self.objects, self.options
+        pipeline.stages = self.stages + (partial(f, **kwargs) if kwargs else f,)
+        return pipeline
+
+    def compute(self):
+        """Run the pipeline and return the new nested object."""
+        return chainapply(self.stages, *self.objects, **self.options)
+
+    def __repr__(self):
+        stages = "".join(f".map({f!r})" for f in self.stages)
+        return f"{type(self).__name__}(<{len(self.objects)} objects>){stages}"
@@ -0,0 +1,42 @@
+"""Native numeric operations on nested containers.
+
+The functions walk the nested objects like `plyr.apply` does, and compute
+on contiguous float32 and float64 buffers (e.g. numpy arrays) directly with
+vectorized loops, releasing the GIL on large buffers. Any other leaf data
+falls back to python's arithmetic operators.
+
+The reductions `sum`, `max`, `dot` and `reduce_norm` accumulate in double
+precision with pairwise summation, and accept strided buffers as well.
+
+`stack` and `concatenate` copy the buffers in the leaves of the nested
+objects into one new buffer per leaf, with several threads and without
+the GIL on large buffers.
+
+The second operand is either a nested object with IDENTICAL structure, or
+a number, which is broadcast to every leaf.
+
+If `inplace` is set, then the leaves of the updated nested object are
+modified in place and the object itself is returned, otherwise a new nested
+object is built from the copies of its leaves (via their `.copy()`).
+"""
+# the operations are compiled into `plyr.base` along with the rest, so that
+#  they share its caches of types and its module state
+from .base import (
+    add,
+    sub,
+    mul,
+    axpy,
+    lerp,
+    sum,
+    max,
+    dot,
+    reduce_norm,
+    stack,
+    concatenate,
+    take,
+    put,
+    pack,
+    unpack,
+    unflatten_buffer,
+    RingBuffer,
+)
@@ -34,9 +34,34 @@ setup(
                 "src/tools.cpp",
                 "src/ragged.cpp",
                 "src/populate.cpp",
+                "src/treedef.cpp",
+                "src/traverse.cpp",
+                "src/reduce.cpp",
+                "src/multiapply.cpp",
+                "src/chainapply.cpp",
+                "src/transpose.cpp",
+                "src/kernels.cpp",
+                "src/buffers.cpp",
+                "src/elementwise.cpp",
+                "src/reductions.cpp",
+                "src/stack.cpp",
+                "src/take.cpp",
+                "src/pack.cpp",
+                "src/ringbuffer.cpp",
             ],
             include_dirs=["src/include"],
-            extra_compile_args=["-O3", "-Ofast", "--std=c++11"],
+            extra_compile_args=[
+                "-O3",
+                # vectorize the sums without `-Ofast`, which would also assume
+                #  finite math and fold away the NaN and inf checks
+                "-fassociative-math",
+                "-fno-signed-zeros",
+                "-fno-trapping-math",
+                "-fno-math-errno",
+                "--std=c++11",
+                "-pthread",
+            ],
+            extra_link_args=["-pthread"],
             language="c++",
         ),
     ],
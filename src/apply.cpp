@@ -4,6 +4,8 @@
 
 #include <apply.h>
 #include <validate.h>
+#include <traverse.h>
+#include <treedef.h>
 // https://edcjones.tripod.com/refcount.html
 // https://pythonextensionpatterns.readthedocs.io/en/latest/refcount.html
 
@@ -19,6 +21,7 @@ PyDoc_STRVAR(
     "    _finalizer=None,\n"
     "    _committer=None,\n"
     "    _strict=True,\n"
+    "    _cache=False,\n"
     "    **kwargs,\n"
     ")\n"
     "\n"
@@ -76,6 +79,14 @@ PyDoc_STRVAR(
     "\n"
     "    NOTE `_strict` does not affect treatment of namedtuples (SEE caveat).\n"
     "\n"
+    "_cache : bool, default=False\n"
+    "    Whether to look up the compiled structure (see `TreeDef`) of the first\n"
+    "    nested object in the cache of traversal plans, keyed by a fingerprint\n"
+    "    of its structure. The nested objects are then flattened and rebuilt by\n"
+    "    a linear walk over the plan, bypassing the per-node type dispatch.\n"
+    "    NOTE the uncached traversal is about as fast, and often faster, since it\n"
+    "    makes a single pass over the objects (see `benchmarks/bench_cache.py`).\n"
+    "\n"
     "**kwargs : variable keyword arguments\n"
     "   The optional keyword arguments passed AS IS to the `callable` every\n"
     "   time it is invoked on the leaf data.\n"
@@ -134,162 +145,100 @@ PyDoc_STRVAR(
 );
 
 
-PyObject* _apply(
-    PyObject *callable,
-    PyObject *main,
-    PyObject *rest,
-    const bool safe,
-    const bool star,
-    PyObject *kwargs,
-    PyObject *finalizer,
-    const bool strict,
-    PyObject *committer);
+// the options are folded in at compile time, unless they are `APPLY_ANY`
+#define APPLY_FLAG(F, value) ((F) == APPLY_ANY ? (value) : (F) == APPLY_ON)
 
 
-static PyObject* _apply_dict(
+template<int STAR, int COMMIT>
+static PyObject* _apply_base(
     PyObject *callable,
     PyObject *main,
-    PyObject *rest,
-    const bool safe,
+    PyObject *const *rest,
+    Py_ssize_t len,
     const bool star,
     PyObject *kwargs,
-    PyObject *finalizer,
-    const bool strict,
-    PyObject *committer)
+    PyObject *committer,
+    PyObject **pool)
 {
-    Py_ssize_t len = PyTuple_GET_SIZE(rest);
-    PyObject *key, *main_, *item_, *rest_ = PyTuple_New(len);
-    if(rest_ == NULL)
-        return NULL;
+    PyObject *output;
 
-    PyObject *output = PyDict_New(), *result = NULL;
-    if(output == NULL) {
-        Py_DECREF(rest_);
-        return NULL;
-    }
+    if (APPLY_FLAG(STAR, star)) {
+        // the arguments (main,) + rest are passed without an intermediate
+        //  tuple (via vectorcall, where available)
+        output = PyObject_CallWithArgs(callable, main, rest, len, kwargs);
 
-    Py_ssize_t pos = 0;
-    // Any references returned by `PyDict_Next` are borrowed from the dict
-    //     https://docs.python.org/3/c-api/dict.html#c.PyDict_Next
-    while (PyDict_Next(main, &pos, &key, &main_)) {
-        for(Py_ssize_t j = 0; j < len; j++) {
-            // `PyDict_GetItem` and `PyTuple_GET_ITEM` return a borrowed reference
-            //     https://docs.python.org/3/c-api/dict.html#c.PyDict_GetItem
-            item_ = PyDict_GetItem(PyTuple_GET_ITEM(rest, j), key);
-
-            // `PyTuple_SetItem` decrefs any non-NULL item already in the tuple
-            //  at the affected position. In contrast, `PyTuple_SET_ITEM` does
-            //  NOT discard references to items being replaced!
-            //    https://docs.python.org/3/c-api/tuple.html#c.PyTuple_SetItem
-            Py_XDECREF(PyTuple_GET_ITEM(rest_, j));
-
-            // a tuple assumes ownership of, or 'steals', the reference, owned
-            //  by a dict from `rest`, so we incref it for protection.
-            Py_INCREF(item_);
-            PyTuple_SET_ITEM(rest_, j, item_);
-        }
-
-        // `result` is a new object, for which we are now responsible
-        result = _apply(callable, main_, rest_, safe, star, kwargs, finalizer, strict, committer);
-        if(result == NULL) {
-            Py_DECREF(rest_);
-
-            // decrefing a dict also applies decref to its contents
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        // dict's setitem DOES NOT steal references to `val` and, apparently,
-        //  to `key`, i.e. does an incref of its own (both value and the key),
-        //  which is why `_apply_dict` logic is different from `_tuple`.
-        //     https://docs.python.org/3/c-api/dict.html#c.PyDict_SetItem
-        PyDict_SetItem(output, key, result);
-
-        // decref the result, so that only `output` owns a ref
-        Py_DECREF(result);
+    } else {
+        // the callable expects the arguments packed into a single tuple,
+        //  which is recycled across the leaves through the `pool`
+        output = PyObject_CallWithPackedArgs(
+            callable, main, rest, len, kwargs, pool);
     }
 
-    // decrefing a tuple with only one reference, as is the case here, also
-    //  decrefs all its items.
-    Py_DECREF(rest_);
+    // bypass the finalizer if _apply_* failed and bubble up the exception
+    if(!APPLY_FLAG(COMMIT, committer != NULL) || output == NULL)
+        return output;
+
+    // The committer is only called on the leaf data
+    PyObject *result = PyObject_CallWithSingleArg(committer, output, NULL);
+    Py_DECREF(output);
 
-    return output;
+    return result;
 }
 
 
-static PyObject* _apply_tuple(
-    PyObject *callable,
-    PyObject *main,
-    PyObject *rest,
-    const bool safe,
-    const bool star,
-    PyObject *kwargs,
-    PyObject *finalizer,
-    const bool strict,
-    PyObject *committer)
-{
-    Py_ssize_t len = PyTuple_GET_SIZE(rest);
-    PyObject *main_, *item_, *rest_ = PyTuple_New(len);
-    if(rest_ == NULL)
-        return NULL;
+// the policy of `_traverse` for `apply`, see `_apply` and `_apply_base`
+template<int SAFE, int STAR, int STRICT, int FINALIZE, int COMMIT>
+struct applier {
+    PyObject *callable;
+    bool safe, star;
+    PyObject *kwargs, *finalizer;
+    bool strict;
+    PyObject *committer;
 
-    Py_ssize_t numel = PyTuple_GET_SIZE(main);
-    PyObject *output = PyTuple_New(numel), *result = NULL;
-    if(output == NULL) {
-        Py_DECREF(rest_);
-        return NULL;
-    }
+    // the number of objects besides the main one
+    Py_ssize_t len;
 
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        main_ = PyTuple_GET_ITEM(main, pos);
-        for(Py_ssize_t j = 0; j < len; j++) {
-            // `PyTuple_GET_ITEM` returns a borrowed reference (from the tuple)
-            //     https://docs.python.org/3/c-api/tuple.html#c.PyTuple_GET_ITEM
-            item_ = PyTuple_GET_ITEM(PyTuple_GET_ITEM(rest, j), pos);
-
-            Py_XDECREF(PyTuple_GET_ITEM(rest_, j));
-
-            Py_INCREF(item_);
-            PyTuple_SET_ITEM(rest_, j, item_);
-        }
-
-        result = _apply(callable, main_, rest_, safe, star, kwargs, finalizer, strict, committer);
-        if(result == NULL) {
-            Py_DECREF(rest_);
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        // `PyTuple_SET_ITEM` steals references and does NOT discard refs
-        // of displaced objects.
-        //     https://docs.python.org/3/c-api/tuple.html#c.PyTuple_SetItem
-        PyTuple_SET_ITEM(output, pos, result);
-    }
+    // an owned ref to the recycled tuple of arguments for `star=False`
+    PyObject *pool;
 
-    Py_DECREF(rest_);
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        PyObject *main = row[0];
+        frame.kind = _traverse_kind(main, APPLY_FLAG(STRICT, strict));
+        if(APPLY_FLAG(SAFE, safe) && len > 0 && !_traverse_validate(frame.kind, row, len))
+            return 0;
 
-    if(PyTuple_CheckExact(main))
-        return output;
+        return _traverse_enter(frame, main);
+    }
 
-    // Preserve namedtuple, devolve others to built-in tuples
-    if(!PyNamedTuple_CheckExact(main))
-        return output;
+    PyObject* leaf(PyObject **row)
+    {
+        // The base case, i.e. having reached the leaf objects (non containers)
+        return _apply_base<STAR, COMMIT>(
+            callable, row[0], row + 1, len, star, kwargs, committer, &pool);
+    }
 
-    // since `namedtuple`-s are immutable and derived from `tuple`, we can
-    //  just call `tp_new` on them
-    // XXX fix this if the namedtuple's implementation changes
-    // https://docs.python.org/3/c-api/typeobj.html#c.PyTypeObject.tp_new
-    PyObject *namedtuple = Py_TYPE(main)->tp_new(Py_TYPE(main), output, NULL);
-    Py_DECREF(output);
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(
+            frame, row, row_, 1 + len, false, APPLY_FLAG(SAFE, safe));
+    }
 
-    return namedtuple;
-}
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        // The finalizer is only called on the inner/nested containers
+        return _traverse_finish(
+            frame, APPLY_FLAG(FINALIZE, finalizer != NULL) ? finalizer : NULL);
+    }
+};
 
 
-static PyObject* _apply_list(
+template<int SAFE, int STAR, int STRICT, int FINALIZE, int COMMIT>
+PyObject* _apply_with(
     PyObject *callable,
     PyObject *main,
-    PyObject *rest,
+    PyObject *const *rest,
+    Py_ssize_t len,
     const bool safe,
     const bool star,
     PyObject *kwargs,
@@ -297,55 +246,41 @@ static PyObject* _apply_list(
     const bool strict,
     PyObject *committer)
 {
-    Py_ssize_t len = PyTuple_GET_SIZE(rest);
-    PyObject *main_, *item_, *rest_ = PyTuple_New(len);
-    if(rest_ == NULL)
-        return NULL;
+    // the nested objects are traversed jointly with an explicit stack, hence
+    //  the depth of nesting is not limited by the recursion limit
+    applier<SAFE, STAR, STRICT, FINALIZE, COMMIT> policy = {
+        callable, safe, star, kwargs, finalizer, strict, committer, len, NULL};
 
-    Py_ssize_t numel = PyList_GET_SIZE(main);
-    PyObject *output = PyList_New(numel), *result = NULL;
-    if(output == NULL) {
-        Py_DECREF(rest_);
-        return NULL;
-    }
+    PyObject *result = _traverse(policy, main, rest, len);
+    Py_XDECREF(policy.pool);
 
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        main_ = PyList_GET_ITEM(main, pos);
-        for(Py_ssize_t j = 0; j < len; j++) {
-            // `PyList_GET_ITEM` returns a borrowed reference (from the list)
-            //     https://docs.python.org/3/c-api/list.html#c.PyList_GET_ITEM
-            item_ = PyList_GET_ITEM(PyTuple_GET_ITEM(rest, j), pos);
-
-            Py_XDECREF(PyTuple_GET_ITEM(rest_, j));
-
-            Py_INCREF(item_);
-            PyTuple_SET_ITEM(rest_, j, item_);
-        }
-
-        result = _apply(callable, main_, rest_, safe, star, kwargs, finalizer, strict, committer);
-        if(result == NULL) {
-            Py_DECREF(rest_);
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        // Like `PyList_SetItem`, `PyList_SET_ITEM` steals the reference from
-        // us. However, unlike it `_SET_ITEM` DOES NOT discard refs of
-        // displaced objects. We're ok, because `output` is a NEW list.
-        //     https://docs.python.org/3/c-api/list.html#c.PyList_SET_ITEM
-        PyList_SET_ITEM(output, pos, result);
-    }
+    return result;
+}
 
-    Py_DECREF(rest_);
 
-    return output;
-}
+// the specializations for `suply`, `tuply`, `s_ply`, `t_ply` and `flatapply`
+template PyObject* _apply_with<APPLY_ON, APPLY_ON, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+    PyObject*, PyObject*, PyObject *const*, Py_ssize_t, bool, bool, PyObject*,
+    PyObject*, bool, PyObject*);
+template PyObject* _apply_with<APPLY_ON, APPLY_OFF, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+    PyObject*, PyObject*, PyObject *const*, Py_ssize_t, bool, bool, PyObject*,
+    PyObject*, bool, PyObject*);
+template PyObject* _apply_with<APPLY_OFF, APPLY_ON, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+    PyObject*, PyObject*, PyObject *const*, Py_ssize_t, bool, bool, PyObject*,
+    PyObject*, bool, PyObject*);
+template PyObject* _apply_with<APPLY_OFF, APPLY_OFF, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+    PyObject*, PyObject*, PyObject *const*, Py_ssize_t, bool, bool, PyObject*,
+    PyObject*, bool, PyObject*);
+template PyObject* _apply_with<APPLY_ON, APPLY_ANY, APPLY_ON, APPLY_OFF, APPLY_ON>(
+    PyObject*, PyObject*, PyObject *const*, Py_ssize_t, bool, bool, PyObject*,
+    PyObject*, bool, PyObject*);
 
 
-static PyObject* _apply_mapping(
+PyObject* _apply(
     PyObject *callable,
     PyObject *main,
-    PyObject *rest,
+    PyObject *const *rest,
+    Py_ssize_t len,
     const bool safe,
     const bool star,
     PyObject *kwargs,
@@ -353,111 +288,40 @@ static PyObject* _apply_mapping(
     const bool strict,
     PyObject *committer)
 {
-    // XXX it's unlikely that we will ever use this branch, because as docs say
-    //  it is impossible to know the type of keys of a mapping at runtime, hence
-    //  lists, tuples, dicts and any objects with `__getitem__` are mappings
-    //  according to `PyMapping_Check`.
-    Py_ssize_t len = PyTuple_GET_SIZE(rest);
-    PyObject *key, *main_, *item_, *rest_ = PyTuple_New(len);
-    if(rest_ == NULL)
-        return NULL;
-
-    PyObject *output = PyDict_New(), *result = Py_None;
-    if(output == NULL) {
-        Py_DECREF(rest_);
-        return NULL;
-    }
-
-    PyObject *items = PyMapping_Items(main);
-    if(items == NULL) {
-        Py_DECREF(rest_);
-        Py_DECREF(output);
-        return NULL;
-    }
-
-    Py_INCREF(result);
-
-    Py_ssize_t numel = PyList_GET_SIZE(items);
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        item_ = PyList_GET_ITEM(items, pos);
-        key = PyTuple_GET_ITEM(item_, 0);
-        main_ = PyTuple_GET_ITEM(item_, 1);
-
-        for(Py_ssize_t j = 0; j < len; j++) {
-            // `PyObject_GetItem` yields a new reference
-            //     https://docs.python.org/3/c-api/object.html#c.PyObject_GetItem
-            item_ = PyObject_GetItem(PyTuple_GET_ITEM(rest, j), key);
-
-            Py_XDECREF(PyTuple_GET_ITEM(rest_, j));
-            PyTuple_SET_ITEM(rest_, j, item_);
-        }
-
-        Py_DECREF(result);
-
-        result = _apply(callable, main_, rest_, safe, star, kwargs, finalizer, strict, committer);
-        if(result == NULL) break;
-
-        PyDict_SetItem(output, key, result);
-    }
-
-    Py_DECREF(items);
-    Py_DECREF(rest_);
-
-    if(result == NULL) return NULL;
-    Py_DECREF(result);
-
-    return output;
-}
-
-
-static PyObject* _apply_base(
-    PyObject *callable,
-    PyObject *main,
-    PyObject *rest,
-    const bool star,
-    PyObject *kwargs,
-    PyObject *committer)
-{
-    PyObject *output;
-
-    Py_ssize_t len = PyTuple_GET_SIZE(rest);
-    PyObject *item_, *args = PyTuple_New(1+len);
-    if(args == NULL) return NULL;
-
-    // reusing `rest` works in our case since the base call actually reassembles
-    //  the full tuple: (main,) + rest
-    Py_INCREF(main);
-    PyTuple_SET_ITEM(args, 0, main);
-    for(Py_ssize_t j = 0; j < len; j++) {
-        item_ = PyTuple_GET_ITEM(rest, j);
-
-        Py_INCREF(item_);
-        PyTuple_SET_ITEM(args, j + 1, item_);
-    }
+    // dispatch the plain strict calls of `apply` to the specializations,
+    //  and everything else to the generic version
+    if(strict && finalizer == NULL && committer == NULL) {
+        if(safe && star)
+            return _apply_with<APPLY_ON, APPLY_ON, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+                callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+                committer);
 
-    if (star) {
-        output = PyObject_Call(callable, args, kwargs);
-    } else {
-        output = PyObject_CallWithSingleArg(callable, args, kwargs);
+        if(safe)
+            return _apply_with<APPLY_ON, APPLY_OFF, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+                callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+                committer);
+
+        if(star)
+            return _apply_with<APPLY_OFF, APPLY_ON, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+                callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+                committer);
+
+        return _apply_with<APPLY_OFF, APPLY_OFF, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+            callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+            committer);
     }
-    Py_DECREF(args);
-
-    // bypass the finalizer if _apply_* failed and bubble up the exception
-    if(committer == NULL || output == NULL)
-        return output;
-
-    // The committer is only called on the leaf data
-    PyObject *result = PyObject_CallWithSingleArg(committer, output, NULL);
-    Py_DECREF(output);
 
-    return result;
+    return _apply_with<APPLY_ANY, APPLY_ANY, APPLY_ANY, APPLY_ANY, APPLY_ANY>(
+        callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+        committer);
 }
 
 
-PyObject* _apply(
+static PyObject* _apply_cached(
     PyObject *callable,
     PyObject *main,
-    PyObject *rest,
+    PyObject *const *rest,
+    Py_ssize_t len,
     const bool safe,
     const bool star,
     PyObject *kwargs,
@@ -465,176 +329,154 @@ PyObject* _apply(
     const bool strict,
     PyObject *committer)
 {
-    PyObject *result;
+    Py_ssize_t count = 1 + len;
 
-    if(PyDict_CheckExact(main) || (!strict && PyDict_Check(main))) {
-        if(safe)
-            if(!_validate_dict(main, rest))
-                return NULL;
+    // jointly flatten the objects along the cached plan of `main`'s structure
+    std::vector<PyObject *> leaves = {};
+    PyTreeDefObject *plan = _treedef_cached_gather(
+        main, rest, len, strict, safe, leaves);
+    if(plan == NULL)
+        return NULL;
 
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _apply_dict(callable, main, rest, safe, star, kwargs, finalizer, strict, committer);
-        Py_LeaveRecursiveCall();
+    Py_ssize_t numel = plan->num_leaves, done = 0;
+    PyObject *result = NULL, *pool = NULL;
 
-    } else if(
-        PyTupleNamedTuple_CheckExact(main) || (!strict && PyTuple_Check(main))
-    ) {
-        if(safe)
-            if(!_validate_tuple(main, rest))
-                return NULL;
+    // the result of each leaf replaces its leaf data from `main`
+    for(; done < numel; done++) {
+        PyObject **row = &leaves[done * count];
 
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _apply_tuple(callable, main, rest, safe, star, kwargs, finalizer, strict, committer);
-        Py_LeaveRecursiveCall();
+        result = _apply_base<APPLY_ANY, APPLY_ANY>(
+            callable, row[0], row + 1, len, star, kwargs, committer, &pool);
+        if(result == NULL)
+            goto finally;
 
-    } else if(PyList_CheckExact(main) || (!strict && PyList_Check(main))) {
-        if(safe)
-            if(!_validate_list(main, rest))
-                return NULL;
+        Py_SETREF(row[0], result);
+    }
 
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _apply_list(callable, main, rest, safe, star, kwargs, finalizer, strict, committer);
-        Py_LeaveRecursiveCall();
+    // pack the results and rebuild the structure with the finalizer
+    for(Py_ssize_t pos = 0; pos < numel; pos++) {
+        for(Py_ssize_t j = 1; j < count; j++)
+            Py_CLEAR(leaves[pos * count + j]);
 
-    } else {
-        // The base case, i.e. having reached the leaf objects (non containers)
-        // is non recursive
-        return _apply_base(callable, main, rest, star, kwargs, committer);
+        leaves[pos] = leaves[pos * count];
     }
 
-    // bypass the finalizer if _apply_* failed and bubble up the exception
-    if(finalizer == NULL || result == NULL)
-        return result;
+    result = _treedef_unflatten(plan, leaves.data(), numel, finalizer);
+    leaves.resize(numel);
+
+finally:
+    for(PyObject *leaf : leaves)
+        Py_XDECREF(leaf);
 
-    // The finalizer is only called on the inner/nested containers, and never
-    //  on the leaf data
-    PyObject *output = PyObject_CallWithSingleArg(finalizer, result, NULL);
-    Py_DECREF(result);
+    Py_XDECREF(pool);
+    Py_DECREF(plan);
 
-    return output;
+    return result;
 }
 
 
 int parse_apply_args(
-    PyObject *args,
+    PyObject *const *args,
+    Py_ssize_t nargs,
     PyObject **callable,
-    PyObject **main,
-    PyObject **rest)
+    PyObject **main)
 {
-    // docs imply that `PyTuple_GetSlice` does not steal references to the elements
-    //  in the slice, meaning that the objects in it are increfed. However, when
-    //  slicing yields the full original tuple, in this case the returned object
-    //  is exactly the original tuple, but with its own refcount incremented.
-    PyObject *first = PyTuple_GetSlice(args, 0, 2);
-    if (first == NULL)
-        return 0;
-
-    int parsed = PyArg_ParseTuple(first, "OO|:apply", callable, main);
-    Py_DECREF(first);
-
-    if (!parsed)
+    // the positionals of a fastcall are borrowed from the caller, who is
+    //  guaranteed to hold on to them for the duration of the call.
+    if(nargs < 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "apply() takes at least 2 arguments (%zd given)", nargs);
         return 0;
+    }
 
+    *callable = args[0];
+    *main = args[1];
     if(!PyCallable_Check(*callable)) {
         PyErr_SetString(PyExc_TypeError, "The first argument must be a callable.");
         return 0;
     }
 
-    // always increfs the items in the slice, since it always creates a new tuple
-    Py_ssize_t len = PyTuple_GET_SIZE(args);
-    *rest = PyTuple_GetSlice(args, 2, len);
-
     return 1;
 }
 
 
-PyObject* apply(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject* apply(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
 {
     // from the URL at the top: {API 1.2.1} the call mechanism guarantees
     //  to hold a reference to every argument for the duration of the call.
-    int safe = 1, star = 1, strict=1;
-    PyObject *callable = NULL, *main = NULL, *rest = NULL;
-    PyObject *finalizer=NULL, *committer=NULL;
+    int safe = 1, star = 1, strict=1, cache=0;
+    PyObject *callable = NULL, *main = NULL, *kwargs = NULL;
 
     // handle `apply(fn, main, *rest, ...)`
     // XXX args remains the owner of the extracted objects, but it is guaranteed
     // to stay alive during the call of `apply`, so no need to incref anything.
-    if(!parse_apply_args(args, &callable, &main, &rest))
+    if(!parse_apply_args(args, nargs, &callable, &main))
         return NULL;
 
+    PyObject *const *rest = args + 2;
+    Py_ssize_t len = nargs - 2;
+
     // handle `apply(..., *, _star, _safe, _finalizer, **kwargs)`
+    // XXX the values of the keywords follow the positionals in `args`, and
+    //  the ones not in `kwlist` are collected into a new `kwargs` dict to be
+    //  passed along to `_apply_base`.
+    static const char *kwlist[] = {
+        "_safe",
+        "_star",
+        "_finalizer",
+        "_committer",
+        "_strict",
+        "_cache",
+        NULL,
+    };
+
+    PyObject *own[] = {NULL, NULL, NULL, NULL, NULL, NULL};
+    PyObject *finalizer = NULL, *committer = NULL, *result = NULL;
+    if(!PyArg_ScanKwnames(
+        "apply", args + nargs, kwnames, kwlist, own, &kwargs
+    ))
+        goto finally;
+
+    if(
+        !PyArg_ParseFlag(own[0], &safe) || !PyArg_ParseFlag(own[1], &star)
+        || !PyArg_ParseFlag(own[4], &strict) || !PyArg_ParseFlag(own[5], &cache)
+    )
+        goto finally;
+
+    finalizer = own[2];
+    committer = own[3];
+
     // XXX if the finalizer is not required, the kwarg must be omitted.
-    if (kwargs) {
-        static const char *kwlist[] = {
-            "_safe",
-            "_star",
-            "_finalizer",
-            "_committer",
-            "_strict",
-            NULL,
-        };
-
-        // Pop apply's kwargs from `kwargs` so that it could be passed along to
-        //  `_apply_base`.
-        PyObject* own = PyDict_SplitItemStrings(kwargs, kwlist, true);
-        if (own == NULL) {
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        PyObject *empty = PyTuple_New(0);
-        if (empty == NULL) {
-            Py_DECREF(own);
-            Py_DECREF(rest);            
-            return NULL;
-        }
-
-        // PyArg_ParseTupleAndKeywords does not do anything with the ownership
-        //  of `PyObject`, https://docs.python.org/3/c-api/arg.html#other-objects
-        // Thus we hold on to the `finalizer` in case its only ref was
-        //  the `kwargs`, which we tinkered with just above.
-        int parsed = PyArg_ParseTupleAndKeywords(
-            empty, own, "|$ppOOp:apply", (char**) kwlist,
-            &safe, &star, &finalizer, &committer, &strict
-        );
-
-        Py_DECREF(empty);
-        if (!parsed) {
-            Py_DECREF(own);
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        // while `own` is alive we can be sure the finalizer it alive too
-        if(finalizer != NULL && !PyCallable_Check(finalizer)) {
-            PyErr_SetString(PyExc_TypeError, "The finalizer must be a callable.");
-
-            Py_DECREF(own);
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        if(committer != NULL && !PyCallable_Check(committer)) {
-            PyErr_SetString(PyExc_TypeError, "The committer must be a callable.");
-
-            Py_DECREF(own);
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        // incref callables PRIOR to decrefing the temporary subdict `own`
-        Py_XINCREF(finalizer);  // incref unless NULL
-        Py_XINCREF(committer);
-        Py_DECREF(own);
+    if(finalizer != NULL && !PyCallable_Check(finalizer)) {
+        PyErr_SetString(PyExc_TypeError, "The finalizer must be a callable.");
+        goto finally;
+    }
+
+    if(committer != NULL && !PyCallable_Check(committer)) {
+        PyErr_SetString(PyExc_TypeError, "The committer must be a callable.");
+        goto finally;
     }
 
     // make the call, then decref everything we might own
-    PyObject *result = _apply(
-        callable, main, rest, safe, star, kwargs, finalizer, strict, committer);
+    if(cache) {
+        result = _apply_cached(
+            callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+            committer);
+
+    } else {
+        result = _apply(
+            callable, main, rest, len, safe, star, kwargs, finalizer, strict,
+            committer);
+
+    }
 
-    Py_XDECREF(finalizer);
-    Py_XDECREF(committer);
-    Py_DECREF(rest);
+finally:
+    Py_XDECREF(kwargs);
 
     return result;
 }
@@ -642,7 +484,7 @@ PyObject* apply(PyObject *self, PyObject *args, PyObject *kwargs)
 
 const PyMethodDef def_apply = {
     "apply",
-    (PyCFunction) apply,
-    METH_VARARGS | METH_KEYWORDS,
+    (PyCFunction) (void(*)(void)) apply,
+    METH_FASTCALL | METH_KEYWORDS,
     __doc__,
 };
@@ -0,0 +1,435 @@
+#include <Python.h>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+
+// advise the kernel to back the buffers of at least this many bytes by huge
+//  pages, where available
+#if defined(__linux__)
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   ifdef MADV_HUGEPAGE
+#       define OPS_MADVISE
+#       define OPS_HUGEPAGE_SIZE (1 << 22)
+#   endif
+#endif
+
+
+int _ops_enter(
+    travframe &frame,
+    PyObject **row,
+    Py_ssize_t len,
+    const bool rebuild)
+{
+    // the nested objects are validated like in safe strict `apply`, with the
+    //  keys of dicts checked in `_traverse_next`
+    frame.kind = _traverse_kind(row[0], true);
+    if(len > 0 && !_traverse_validate(frame.kind, row, len))
+        return 0;
+
+    return _traverse_enter(frame, row[0], rebuild);
+}
+
+
+bool _ops_same_shape(const Py_buffer &x, const Py_buffer &y)
+{
+    if(x.ndim != y.ndim || x.len != y.len)
+        return false;
+
+    for(int k = 0; k < x.ndim; k++)
+        if(x.shape[k] != y.shape[k])
+            return false;
+
+    return true;
+}
+
+
+const char* _ops_format(const char *format)
+{
+    // the struct-module format of the elements with the native byte order
+    //  prefix stripped, for comparing the formats of the leaves
+    switch(*format) {
+        case '@':
+        case '=':
+#if PY_LITTLE_ENDIAN
+        case '<':
+#else
+        case '>':
+        case '!':
+#endif
+            return format + 1;
+    }
+
+    return format;
+}
+
+
+const char* _ops_format(const Py_buffer &view)
+{
+    return _ops_format(view.format == NULL ? "B" : view.format);
+}
+
+
+bool _ops_same_format(const char *format, const char *other)
+{
+    // the formats of the elements of the same size are the same, if they
+    //  differ only in the code of the native integer, e.g. `l` and `q`
+    format = _ops_format(format);
+    other = _ops_format(other);
+    if(strcmp(format, other) == 0)
+        return true;
+
+    if(strlen(format) != 1 || strlen(other) != 1)
+        return false;
+
+    return (
+        (strchr("bhilqn", format[0]) != NULL && strchr("bhilqn", other[0]) != NULL)
+        || (strchr("BHILQN", format[0]) != NULL && strchr("BHILQN", other[0]) != NULL)
+    );
+}
+
+
+static void OpsBuffer_dealloc(OpsBufferObject *self)
+{
+    if(self->source != NULL) {
+        PyBuffer_Release(self->source);
+        PyMem_Free(self->source);
+
+    } else {
+        PyMem_Free(self->data);
+
+    }
+
+    PyMem_Free(self->format);
+    PyMem_Free(self->shape);
+
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+
+static int OpsBuffer_getbuffer(OpsBufferObject *self, Py_buffer *view, int flags)
+{
+    // the buffer is C-contiguous, so any request is satisfied, unless it is
+    //  a view into a read-only buffer
+    int readonly = self->source != NULL && self->source->readonly;
+    if(readonly && (flags & PyBUF_WRITABLE)) {
+        PyErr_SetString(PyExc_BufferError, "The buffer is read-only.");
+        view->obj = NULL;
+        return -1;
+    }
+
+    view->obj = (PyObject *) self;
+    Py_INCREF(self);
+
+    view->buf = self->data;
+    view->len = self->len;
+    view->readonly = readonly;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+    view->ndim = self->ndim;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? self->shape + self->ndim : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    return 0;
+}
+
+
+static PyBufferProcs OpsBuffer_as_buffer = {
+    (getbufferproc) OpsBuffer_getbuffer,  /* bf_getbuffer */
+    0,                                    /* bf_releasebuffer */
+};
+
+
+PyTypeObject OpsBuffer_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "plyr.Buffer",                  /* tp_name */
+    sizeof(OpsBufferObject),        /* tp_basicsize */
+    0,                              /* tp_itemsize */
+    (destructor) OpsBuffer_dealloc, /* tp_dealloc */
+    0,                              /* tp_vectorcall_offset */
+    0,                              /* tp_getattr */
+    0,                              /* tp_setattr */
+    0,                              /* tp_as_async */
+    0,                              /* tp_repr */
+    0,                              /* tp_as_number */
+    0,                              /* tp_as_sequence */
+    0,                              /* tp_as_mapping */
+    0,                              /* tp_hash */
+    0,                              /* tp_call */
+    0,                              /* tp_str */
+    0,                              /* tp_getattro */
+    0,                              /* tp_setattro */
+    &OpsBuffer_as_buffer,           /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,             /* tp_flags */
+    PyDoc_STR(
+        "The memory of the leaves made by `stack` and `concatenate`, or the"
+        " view of the leaves made by `unpack`."
+    ),                              /* tp_doc */
+};
+
+
+OpsBufferObject* _ops_buffer_new(
+    const char *format,
+    Py_ssize_t itemsize,
+    int ndim,
+    Py_ssize_t total,
+    Py_buffer *source)
+{
+    // a new buffer of `total` bytes with an unset shape, which has its own
+    //  uninitialized memory, or steals the acquired `source`
+    OpsBufferObject *self = PyObject_New(OpsBufferObject, &OpsBuffer_Type);
+    if(self == NULL) {
+        if(source != NULL) {
+            PyBuffer_Release(source);
+            PyMem_Free(source);
+        }
+
+        return NULL;
+    }
+
+    self->source = source;
+    self->len = total;
+    self->itemsize = itemsize;
+    self->ndim = ndim;
+    self->data = NULL;
+    if(source == NULL)
+        self->data = (char *) PyMem_Malloc(total > 0 ? total : 1);
+
+    self->format = (char *) PyMem_Malloc(strlen(format) + 1);
+    self->shape = PyMem_New(Py_ssize_t, ndim > 0 ? 2 * ndim : 1);
+    if(
+        (source == NULL && self->data == NULL)
+        || self->format == NULL || self->shape == NULL
+    ) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    strcpy(self->format, format);
+
+#ifdef OPS_MADVISE
+    // large buffers are backed by huge pages, which saves most of the page
+    //  faults of the first copy (cf. `npy_alloc_cache` in numpy)
+    if(source == NULL && total >= OPS_HUGEPAGE_SIZE) {
+        uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+        uintptr_t start = ((uintptr_t) self->data + page - 1) & ~(page - 1);
+        uintptr_t end = (uintptr_t) self->data + total;
+        if(start < end)
+            madvise((void *) start, end - start, MADV_HUGEPAGE);
+    }
+#endif
+
+    return self;
+}
+
+
+void _ops_buffer_strides(OpsBufferObject *self)
+{
+    // the C-contiguous strides of the shape
+    Py_ssize_t *shape = self->shape, *strides = self->shape + self->ndim;
+
+    Py_ssize_t stride = self->itemsize;
+    for(int k = self->ndim - 1; k >= 0; k--) {
+        strides[k] = stride;
+        stride *= shape[k];
+    }
+}
+
+
+PyObject* _ops_buffer(
+    const Py_buffer &main,
+    Py_ssize_t first,
+    Py_ssize_t total,
+    const bool concat,
+    const int axis)
+{
+    // a new uninitialized buffer of `total` bytes with the format of `main`,
+    //  and the stacked or the concatenated shape, which has `first` items
+    //  along the `axis`
+    int ndim = concat ? main.ndim : main.ndim + 1;
+    OpsBufferObject *self = _ops_buffer_new(
+        main.format == NULL ? "B" : main.format, main.itemsize, ndim, total, NULL);
+    if(self == NULL)
+        return NULL;
+
+    // the other dims are those of the leaves
+    Py_ssize_t *shape = self->shape;
+    for(int k = 0; k < ndim; k++) {
+        if(k == axis) {
+            shape[k] = first;
+
+        } else {
+            shape[k] = main.shape[concat || k < axis ? k : k - 1];
+
+        }
+    }
+
+    _ops_buffer_strides(self);
+
+    return (PyObject *) self;
+}
+
+
+PyObject* _ops_view(
+    PyObject *flat,
+    int flags,
+    Py_ssize_t offset,
+    const char *format,
+    Py_ssize_t itemsize,
+    const std::vector<Py_ssize_t> &dims)
+{
+    // a memoryview of the C-contiguous array at `offset` bytes in the flat
+    //  buffer, which is a view into its own export of the buffer
+    Py_buffer *source = PyMem_New(Py_buffer, 1);
+    if(source == NULL)
+        return PyErr_NoMemory();
+
+    if(PyObject_GetBuffer(flat, source, flags) < 0) {
+        PyMem_Free(source);
+        return NULL;
+    }
+
+    int ndim = (int) dims.size();
+    Py_ssize_t nbytes = itemsize;
+    for(Py_ssize_t dim : dims)
+        nbytes *= dim;
+
+    OpsBufferObject *data = _ops_buffer_new(format, itemsize, ndim, nbytes, source);
+    if(data == NULL)
+        return NULL;
+
+    data->data = (char *) source->buf + offset;
+    for(int k = 0; k < ndim; k++)
+        data->shape[k] = dims[k];
+
+    _ops_buffer_strides(data);
+
+    PyObject *result = PyMemoryView_FromObject((PyObject *) data);
+    Py_DECREF(data);
+
+    return result;
+}
+
+
+int _ops_indices(PyObject *obj, std::vector<Py_ssize_t> &indices)
+{
+    // read a 1d buffer of integers, e.g. a numpy array of int64, or
+    //  a sequence of python ints into `indices`
+    Py_buffer view;
+    if(PyObject_GetBuffer(obj, &view, PyBUF_RECORDS_RO) == 0) {
+        const char *format = _ops_format(view);
+        int status = 1;
+        if(view.ndim != 1 || format[0] == '\0' || format[1] != '\0'
+           || strchr("bBhHiIlLqQnN", format[0]) == NULL) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "The indices must be a 1d buffer of integers, not '%s' of %d dims",
+                view.format == NULL ? "B" : view.format, view.ndim);
+            status = 0;
+
+        } else {
+            // ctypes arrays export no strides, since they are C-contiguous
+            bool is_signed = strchr("bhilqn", format[0]) != NULL;
+            Py_ssize_t stride = view.strides ? view.strides[0] : view.itemsize;
+            indices.resize(view.shape[0]);
+            for(Py_ssize_t j = 0; j < view.shape[0] && status; j++) {
+                const char *item = (const char *) view.buf + j * stride;
+
+                // the items of any size are sign- or zero-extended
+                int64_t value = 0;
+                if(is_signed) {
+                    switch(view.itemsize) {
+                        case 1: { int8_t x; memcpy(&x, item, 1); value = x; break; }
+                        case 2: { int16_t x; memcpy(&x, item, 2); value = x; break; }
+                        case 4: { int32_t x; memcpy(&x, item, 4); value = x; break; }
+                        default: { int64_t x; memcpy(&x, item, 8); value = x; break; }
+                    }
+
+                } else {
+                    switch(view.itemsize) {
+                        case 1: { uint8_t x; memcpy(&x, item, 1); value = x; break; }
+                        case 2: { uint16_t x; memcpy(&x, item, 2); value = x; break; }
+                        case 4: { uint32_t x; memcpy(&x, item, 4); value = x; break; }
+                        default: {
+                            uint64_t x; memcpy(&x, item, 8);
+                            if(x > (uint64_t) PY_SSIZE_T_MAX) {
+                                PyErr_Format(
+                                    PyExc_IndexError,
+                                    "index %llu is out of bounds",
+                                    (unsigned long long) x);
+                                status = 0;
+                            }
+
+                            value = (int64_t) x;
+                            break;
+                        }
+                    }
+
+                }
+
+                if(status && (value < PY_SSIZE_T_MIN || value > PY_SSIZE_T_MAX)) {
+                    PyErr_Format(
+                        PyExc_IndexError,
+                        "index %lld is out of bounds", (long long) value);
+                    status = 0;
+                }
+
+                indices[j] = (Py_ssize_t) value;
+            }
+        }
+
+        PyBuffer_Release(&view);
+
+        return status;
+    }
+
+    PyErr_Clear();
+
+    PyObject *seq = PySequence_Fast(
+        obj, "The indices must be a 1d buffer or a sequence of integers.");
+    if(seq == NULL)
+        return 0;
+
+    Py_ssize_t len = PySequence_Fast_GET_SIZE(seq);
+    indices.resize(len);
+    for(Py_ssize_t j = 0; j < len; j++) {
+        indices[j] = PyNumber_AsSsize_t(
+            PySequence_Fast_GET_ITEM(seq, j), PyExc_IndexError);
+        if(indices[j] == -1 && PyErr_Occurred()) {
+            Py_DECREF(seq);
+            return 0;
+        }
+    }
+
+    Py_DECREF(seq);
+
+    return 1;
+}
+
+
+int _ops_check_bounds(
+    const std::vector<Py_ssize_t> &indices,
+    int axis,
+    Py_ssize_t dim)
+{
+    for(Py_ssize_t pos : indices) {
+        if(pos < -dim || pos >= dim) {
+            PyErr_Format(
+                PyExc_IndexError,
+                "index %zd is out of bounds for axis %d with size %zd",
+                pos, axis, dim);
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,191 @@
+#include <Python.h>
+
+#include <chainapply.h>
+#include <validate.h>
+#include <tools.h>
+#include <traverse.h>
+
+
+PyDoc_STRVAR(
+    __doc__,
+    "\n"
+    "chainapply(callables, *objects, _safe=True, _star=True, _strict=True)\n"
+    "\n"
+    "Compute the composition of the functions on the leaf data of the nested\n"
+    "objects in one traversal.\n"
+    "\n"
+    "Parameters\n"
+    "----------\n"
+    "callables : sequence of callables\n"
+    "    The stages of the pipeline. The first callable gets the leaf data\n"
+    "    as `.apply` does, and each next one -- the result of the previous.\n"
+    "    If the sequence is empty, then the leaf data of the first object is\n"
+    "    taken as it is.\n"
+    "\n"
+    "*objects : nested objects\n"
+    "    All remaining positionals are assumed to be nested objects, that\n"
+    "    supply arguments for the first callable from their leaf data.\n"
+    "\n"
+    "_safe, _star, _strict : bool, default=True\n"
+    "    See `.apply`.\n"
+    "\n"
+    "Returns\n"
+    "-------\n"
+    "result : a new nested object\n"
+    "    The nested object with the structure of the first nested object,\n"
+    "    that contains the values returned by the last callable.\n"
+    "\n"
+    "Details\n"
+    "-------\n"
+    "No intermediate nested objects are built, so\n"
+    "\n"
+    ">>> chainapply((f1, f2, f3), x)\n"
+    "\n"
+    "is equivalent to, but faster than\n"
+    "\n"
+    ">>> apply(f3, apply(f2, apply(f1, x)))\n"
+    "\n"
+    "Use `functools.partial` to pass keyword arguments to the stages. See\n"
+    "also `plyr.lazy`.\n"
+    "\n"
+);
+
+
+// the policy of `_traverse` for `chainapply`
+struct chainer {
+    PyObject *const *callables;
+    Py_ssize_t count;
+    bool safe, star, strict;
+
+    // the number of objects besides the main one
+    Py_ssize_t len;
+
+    // an owned ref to the recycled tuple of arguments for `star=False`
+    PyObject *pool;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], strict);
+        if(safe && len > 0 && !_traverse_validate(frame.kind, row, len))
+            return 0;
+
+        return _traverse_enter(frame, row[0]);
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        PyObject *result = row[0];
+        if(count == 0) {
+            Py_INCREF(result);
+            return result;
+        }
+
+        // the first stage gets the leaf data like `apply` does
+        if(star) {
+            result = PyObject_CallWithArgs(
+                callables[0], row[0], row + 1, len, NULL);
+
+        } else {
+            result = PyObject_CallWithPackedArgs(
+                callables[0], row[0], row + 1, len, NULL, &pool);
+
+        }
+
+        // the intermediate results are passed from stage to stage
+        for(Py_ssize_t j = 1; j < count && result != NULL; j++)
+            Py_SETREF(result, PyObject_CallWithSingleArg(
+                callables[j], result, NULL));
+
+        return result;
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1 + len, false, safe);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+static PyObject* _chainapply(
+    PyObject *const *callables,
+    Py_ssize_t count,
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    const bool safe,
+    const bool star,
+    const bool strict)
+{
+    chainer policy = {callables, count, safe, star, strict, len, NULL};
+
+    PyObject *result = _traverse(policy, main, rest, len);
+    Py_XDECREF(policy.pool);
+
+    return result;
+}
+
+
+PyObject* chainapply(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    int safe = 1, star = 1, strict = 1;
+
+    // `chainapply(callables, main, *rest, _safe, _star, _strict)`
+    if(nargs < 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "chainapply() takes at least 2 arguments (%zd given)", nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"_safe", "_star", "_strict", NULL};
+
+    PyObject *own[] = {NULL, NULL, NULL};
+    if(!PyArg_ScanKwnames("chainapply", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    if(
+        !PyArg_ParseFlag(own[0], &safe) || !PyArg_ParseFlag(own[1], &star)
+        || !PyArg_ParseFlag(own[2], &strict)
+    )
+        return NULL;
+
+    // an immutable copy, since the callables may change the sequence
+    PyObject *callables = PySequence_Tuple(args[0]), *result = NULL;
+    if(callables == NULL)
+        return NULL;
+
+    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(callables); j++) {
+        if(!PyCallable_Check(PyTuple_GET_ITEM(callables, j))) {
+            PyErr_SetString(
+                PyExc_TypeError,
+                "The first argument must be a sequence of callables.");
+            goto finally;
+        }
+    }
+
+    result = _chainapply(
+        &PyTuple_GET_ITEM(callables, 0), PyTuple_GET_SIZE(callables),
+        args[1], args + 2, nargs - 2, safe, star, strict);
+
+finally:
+    Py_DECREF(callables);
+
+    return result;
+}
+
+
+const PyMethodDef def_chainapply = {
+    "chainapply",
+    (PyCFunction) (void(*)(void)) chainapply,
+    METH_FASTCALL | METH_KEYWORDS,
+    __doc__,
+};
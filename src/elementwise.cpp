@@ -0,0 +1,432 @@
+#include <Python.h>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <elementwise.h>
+
+
+static bool _ops_is_number(PyObject *obj)
+{
+    return PyFloat_Check(obj) || PyLong_Check(obj);
+}
+
+
+static PyObject* _ops_copy(PyObject *obj)
+{
+    // `.copy()` of numpy arrays and the like, or `copy.copy` for the rest
+    PyObject *copy = PyObject_CallMethod(obj, "copy", NULL);
+    if(copy != NULL || !PyErr_ExceptionMatches(PyExc_AttributeError))
+        return copy;
+
+    PyErr_Clear();
+
+    return PyObject_CallMethod(obj, "__copy__", NULL);
+}
+
+
+static void _ops_kernel(
+    int dtype,
+    int op,
+    void *dst,
+    const void *src,
+    double scalar,
+    double alpha,
+    Py_ssize_t numel)
+{
+    if(dtype == KERNEL_F32) {
+        _kernel_elementwise_f32(
+            op, (float *) dst, (const float *) src,
+            (float) scalar, (float) alpha, numel);
+
+    } else {
+        _kernel_elementwise_f64(
+            op, (double *) dst, (const double *) src,
+            scalar, alpha, numel);
+
+    }
+}
+
+
+static int _ops_native(
+    int op,
+    PyObject *dst,
+    PyObject *src,
+    PyObject *alpha,
+    const bool inplace,
+    PyObject **result)
+{
+    // compute the leaf with a kernel and return 1, or decline with 0 and no
+    //  error set, if the leaf data is not supported by the kernels
+    double scalar = 0., a = 0.;
+    if(alpha != NULL) {
+        a = PyFloat_AsDouble(alpha);
+        if(a == -1. && PyErr_Occurred()) {
+            PyErr_Clear();
+            return 0;
+        }
+    }
+
+    Py_buffer d, s;
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+    if(PyObject_GetBuffer(dst, &d, flags | (inplace ? PyBUF_WRITABLE : 0)) < 0) {
+        PyErr_Clear();
+        return 0;
+    }
+
+    int dtype = _kernel_dtype(&d);
+    Py_ssize_t len = d.len;
+
+    // the second operand is either a number, or a buffer just like `dst`
+    bool sview = false;
+    if(dtype == KERNEL_NONE) {
+        // not supported
+
+    } else if(_ops_is_number(src)) {
+        scalar = PyFloat_AsDouble(src);
+        if(scalar == -1. && PyErr_Occurred()) {
+            PyErr_Clear();
+            dtype = KERNEL_NONE;
+        }
+
+    } else if(PyObject_GetBuffer(src, &s, flags) < 0) {
+        PyErr_Clear();
+        dtype = KERNEL_NONE;
+
+    } else {
+        // a mismatch in shape is left to the broadcasting of the operands
+        sview = true;
+        if(_kernel_dtype(&s) != dtype || !_ops_same_shape(d, s))
+            dtype = KERNEL_NONE;
+
+        // the kernels read `src` while writing `dst` in chunks, so partially
+        //  overlapping operands, e.g. `a[1:]` and `a[:-1]`, are left to the
+        //  generic path, which copies them like numpy
+        const char *lo = (const char *) d.buf, *hi = lo + d.len;
+        const char *slo = (const char *) s.buf, *shi = slo + s.len;
+        if(inplace && slo != lo && slo < hi && lo < shi)
+            dtype = KERNEL_NONE;
+
+    }
+
+    // an out-of-place result is computed in place in a copy of `dst`
+    PyObject *copy = NULL;
+    if(dtype == KERNEL_NONE || !inplace)
+        PyBuffer_Release(&d);
+
+    if(dtype != KERNEL_NONE && !inplace) {
+        copy = _ops_copy(dst);
+        if(copy == NULL) {
+            PyErr_Clear();
+            dtype = KERNEL_NONE;
+
+        } else if(PyObject_GetBuffer(copy, &d, flags | PyBUF_WRITABLE) < 0) {
+            PyErr_Clear();
+            Py_CLEAR(copy);
+            dtype = KERNEL_NONE;
+
+        } else if(_kernel_dtype(&d) != dtype || d.len != len) {
+            PyBuffer_Release(&d);
+            Py_CLEAR(copy);
+            dtype = KERNEL_NONE;
+
+        }
+    }
+
+    if(dtype == KERNEL_NONE) {
+        if(sview)
+            PyBuffer_Release(&s);
+
+        return 0;
+    }
+
+    const void *src_ = sview ? s.buf : NULL;
+    Py_ssize_t numel = len / d.itemsize;
+    if(numel < KERNEL_NOGIL_SIZE) {
+        _ops_kernel(dtype, op, d.buf, src_, scalar, a, numel);
+
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        _ops_kernel(dtype, op, d.buf, src_, scalar, a, numel);
+        Py_END_ALLOW_THREADS
+    }
+
+    PyBuffer_Release(&d);
+    if(sview)
+        PyBuffer_Release(&s);
+
+    if(inplace) {
+        Py_INCREF(dst);
+        *result = dst;
+
+    } else {
+        *result = copy;
+
+    }
+
+    return 1;
+}
+
+
+static PyObject* _ops_generic(
+    int op,
+    PyObject *dst,
+    PyObject *src,
+    PyObject *alpha,
+    const bool inplace)
+{
+    // compute the leaf with python's arithmetic protocol, i.e. `dst + src`,
+    //  `dst += src`, `alpha * src + dst`, `dst + alpha * (src - dst)` etc.
+    PyObject *term = NULL, *result = NULL;
+    switch(op) {
+        case KERNEL_ADD:
+            term = src;
+            Py_INCREF(term);
+            break;
+
+        case KERNEL_SUB:
+            result = inplace
+                ? PyNumber_InPlaceSubtract(dst, src) : PyNumber_Subtract(dst, src);
+            break;
+
+        case KERNEL_MUL:
+            result = inplace
+                ? PyNumber_InPlaceMultiply(dst, src) : PyNumber_Multiply(dst, src);
+            break;
+
+        case KERNEL_AXPY:
+            term = PyNumber_Multiply(alpha, src);
+            if(term == NULL)
+                return NULL;
+
+            break;
+
+        case KERNEL_LERP: {
+            PyObject *diff = PyNumber_Subtract(src, dst);
+            if(diff == NULL)
+                return NULL;
+
+            term = PyNumber_Multiply(alpha, diff);
+            Py_DECREF(diff);
+            if(term == NULL)
+                return NULL;
+
+            break;
+        }
+    }
+
+    if(term != NULL) {
+        result = inplace
+            ? PyNumber_InPlaceAdd(dst, term) : PyNumber_Add(dst, term);
+        Py_DECREF(term);
+    }
+
+    // the result of an in-place operation is discarded, hence it must be the
+    //  very same object
+    if(inplace && result != NULL && result != dst) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "'%s' leaves cannot be updated in place", Py_TYPE(dst)->tp_name);
+        Py_CLEAR(result);
+    }
+
+    return result;
+}
+
+
+// the policy of `_traverse` for the operations, see `_ops`
+struct arithmetic {
+    int op;
+    PyObject *alpha;
+    bool inplace;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        // the numbers are broadcast
+        Py_ssize_t len = _ops_is_number(row[1]) ? 0 : 1;
+
+        return _ops_enter(frame, row, len, !inplace);
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        PyObject *result = NULL;
+        if(_ops_native(op, row[0], row[1], alpha, inplace, &result))
+            return result;
+
+        return _ops_generic(op, row[0], row[1], alpha, inplace);
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 2, true, true);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        if(inplace)
+            Py_RETURN_NONE;
+
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+static PyObject* _ops(
+    int op,
+    PyObject *dst,
+    PyObject *src,
+    PyObject *alpha,
+    const bool inplace)
+{
+    arithmetic policy = {op, alpha, inplace};
+
+    PyObject *result = _traverse(policy, dst, &src, 1);
+    if(result == NULL || !inplace)
+        return result;
+
+    // the in-place operations return the updated object itself
+    Py_DECREF(result);
+    Py_INCREF(dst);
+
+    return dst;
+}
+
+
+static PyObject* _ops_parse(
+    const char *fname,
+    int op,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    // `fn(x, y, /, *, inplace=False)` updates `x`, `axpy(alpha, x, y, ...)`
+    //  updates `y` and `lerp(x, y, weight, ...)` updates `x`
+    Py_ssize_t expected = (op == KERNEL_AXPY || op == KERNEL_LERP) ? 3 : 2;
+    if(nargs != expected) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "%s() takes exactly %zd positional arguments (%zd given)",
+            fname, expected, nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"inplace", NULL};
+
+    int inplace = 0;
+    PyObject *own[] = {NULL};
+    if(!PyArg_ScanKwnames(fname, args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    if(!PyArg_ParseFlag(own[0], &inplace))
+        return NULL;
+
+    if(op == KERNEL_AXPY)
+        return _ops(op, args[2], args[1], args[0], inplace);
+
+    if(op == KERNEL_LERP)
+        return _ops(op, args[0], args[1], args[2], inplace);
+
+    return _ops(op, args[0], args[1], NULL, inplace);
+}
+
+
+PyObject* add(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ops_parse("add", KERNEL_ADD, args, nargs, kwnames);
+}
+
+
+PyObject* sub(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ops_parse("sub", KERNEL_SUB, args, nargs, kwnames);
+}
+
+
+PyObject* mul(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ops_parse("mul", KERNEL_MUL, args, nargs, kwnames);
+}
+
+
+PyObject* axpy(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ops_parse("axpy", KERNEL_AXPY, args, nargs, kwnames);
+}
+
+
+PyObject* lerp(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ops_parse("lerp", KERNEL_LERP, args, nargs, kwnames);
+}
+
+
+const PyMethodDef def_add = {
+    "add",
+    (PyCFunction) (void(*)(void)) add,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "add(x, y, *, inplace=False)\n"
+        "\n"
+        "Compute `x + y` on the leaves of the nested objects.\n"
+    ),
+};
+
+
+const PyMethodDef def_sub = {
+    "sub",
+    (PyCFunction) (void(*)(void)) sub,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "sub(x, y, *, inplace=False)\n"
+        "\n"
+        "Compute `x - y` on the leaves of the nested objects.\n"
+    ),
+};
+
+
+const PyMethodDef def_mul = {
+    "mul",
+    (PyCFunction) (void(*)(void)) mul,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "mul(x, y, *, inplace=False)\n"
+        "\n"
+        "Compute `x * y` on the leaves of the nested objects.\n"
+    ),
+};
+
+
+const PyMethodDef def_axpy = {
+    "axpy",
+    (PyCFunction) (void(*)(void)) axpy,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "axpy(alpha, x, y, *, inplace=False)\n"
+        "\n"
+        "Compute `alpha * x + y` on the leaves of the nested objects with\n"
+        "a number `alpha`. The result has the structure of `y`, which is\n"
+        "updated, if `inplace` is set, e.g. `axpy(-lr, grads, params)`.\n"
+    ),
+};
+
+
+const PyMethodDef def_lerp = {
+    "lerp",
+    (PyCFunction) (void(*)(void)) lerp,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "lerp(x, y, weight, *, inplace=False)\n"
+        "\n"
+        "Compute `x + weight * (y - x)` on the leaves of the nested objects\n"
+        "with a number `weight`, e.g. `lerp(target, online, tau)`.\n"
+    ),
+};
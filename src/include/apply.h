@@ -1,13 +1,37 @@
 int parse_apply_args(
-    PyObject *args,
+    PyObject *const *args,
+    Py_ssize_t nargs,
     PyObject **callable,
-    PyObject **main,
-    PyObject **rest);
+    PyObject **main);
+
+// the states of the options of `_apply_with`: fixed off or on at compile
+//  time, or taken from the arguments at run time
+enum {
+    APPLY_OFF = 0,
+    APPLY_ON,
+    APPLY_ANY,
+};
+
+// `_apply` specialized on its options, instantiated in `apply.cpp` for the
+//  entry points in `plyr.cpp`
+template<int SAFE, int STAR, int STRICT, int FINALIZE, int COMMIT>
+PyObject* _apply_with(
+    PyObject *callable,
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    const bool safe,
+    const bool star,
+    PyObject *kwargs,
+    PyObject *finalizer,
+    const bool strict,
+    PyObject *committer);
 
 PyObject* _apply(
     PyObject *callable,
     PyObject *main,
-    PyObject *rest,
+    PyObject *const *rest,
+    Py_ssize_t len,
     bool const safe,
     bool const star,
     PyObject *kwargs,
@@ -17,7 +41,8 @@ PyObject* _apply(
 
 PyObject* apply(
     PyObject *self,
-    PyObject *args,
-    PyObject *kwargs);
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
 
 extern const PyMethodDef def_apply;
@@ -0,0 +1,109 @@
+#include <vector>
+
+// XXX include after `traverse.h` and `kernels.h`
+
+// a C-contiguous buffer of any format and shape, which owns its memory and
+//  is exported to the memoryviews made by `stack` and `concatenate`, or is
+//  a view into the memory of another buffer made by `unpack`
+typedef struct {
+    PyObject_HEAD
+    char *data;
+    Py_ssize_t len, itemsize;
+    int ndim;
+    // the copy of the format, and the shape followed by the strides
+    char *format;
+    Py_ssize_t *shape;
+    // the acquired buffer, which owns the memory of a view, or NULL
+    Py_buffer *source;
+} OpsBufferObject;
+
+extern PyTypeObject OpsBuffer_Type;
+
+// the rows of a C-contiguous buffer to be copied along an axis, see
+//  `_kernel_take`
+struct rowcopy {
+    char *dst;
+    const char *src;
+    Py_ssize_t outer, dim, inner;
+};
+
+
+// the copies made at once when the traversal is over, and the views of the
+//  buffers, which are kept until then
+struct rowcopies {
+    std::vector<Py_buffer> views;
+    std::vector<rowcopy> jobs;
+
+    // the total number of elements copied
+    Py_ssize_t numel;
+
+    void run(const std::vector<Py_ssize_t> &indices, unsigned threads)
+    {
+        for(const rowcopy &job : jobs)
+            _kernel_take(
+                job.dst, job.src, indices.data(), indices.size(),
+                job.outer, job.dim, job.inner, threads);
+    }
+
+    void release()
+    {
+        for(Py_buffer &view : views)
+            PyBuffer_Release(&view);
+
+        views.clear();
+    }
+};
+
+int _ops_enter(
+    travframe &frame,
+    PyObject **row,
+    Py_ssize_t len,
+    const bool rebuild);
+
+bool _ops_same_shape(
+    const Py_buffer &x,
+    const Py_buffer &y);
+
+const char* _ops_format(
+    const char *format);
+
+const char* _ops_format(
+    const Py_buffer &view);
+
+bool _ops_same_format(
+    const char *format,
+    const char *other);
+
+OpsBufferObject* _ops_buffer_new(
+    const char *format,
+    Py_ssize_t itemsize,
+    int ndim,
+    Py_ssize_t total,
+    Py_buffer *source);
+
+void _ops_buffer_strides(
+    OpsBufferObject *self);
+
+PyObject* _ops_buffer(
+    const Py_buffer &main,
+    Py_ssize_t first,
+    Py_ssize_t total,
+    const bool concat,
+    const int axis=0);
+
+PyObject* _ops_view(
+    PyObject *flat,
+    int flags,
+    Py_ssize_t offset,
+    const char *format,
+    Py_ssize_t itemsize,
+    const std::vector<Py_ssize_t> &dims);
+
+int _ops_indices(
+    PyObject *obj,
+    std::vector<Py_ssize_t> &indices);
+
+int _ops_check_bounds(
+    const std::vector<Py_ssize_t> &indices,
+    int axis,
+    Py_ssize_t dim);
@@ -0,0 +1,7 @@
+PyObject* chainapply(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+extern const PyMethodDef def_chainapply;
@@ -0,0 +1,35 @@
+PyObject* add(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* sub(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* mul(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* axpy(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* lerp(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+extern const PyMethodDef def_add;
+extern const PyMethodDef def_sub;
+extern const PyMethodDef def_mul;
+extern const PyMethodDef def_axpy;
+extern const PyMethodDef def_lerp;
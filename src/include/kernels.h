@@ -0,0 +1,103 @@
+// the element types of the buffers supported by the kernels
+enum {
+    KERNEL_NONE = 0,
+    KERNEL_F32,
+    KERNEL_F64,
+};
+
+// the elementwise operations, which update `dst` in place with `src`, or
+//  with `scalar`, if `src` is NULL
+enum {
+    KERNEL_ADD = 0,  // dst += src
+    KERNEL_SUB,      // dst -= src
+    KERNEL_MUL,      // dst *= src
+    KERNEL_AXPY,     // dst += alpha * src
+    KERNEL_LERP,     // dst += alpha * (src - dst)
+};
+
+// the buffers of at least this many elements are processed without the GIL
+#define KERNEL_NOGIL_SIZE 4096
+
+int _kernel_dtype(
+    const Py_buffer *view);
+
+void _kernel_elementwise_f32(
+    int op,
+    float *dst,
+    const float *src,
+    float scalar,
+    float alpha,
+    Py_ssize_t n);
+
+void _kernel_elementwise_f64(
+    int op,
+    double *dst,
+    const double *src,
+    double scalar,
+    double alpha,
+    Py_ssize_t n);
+
+// the reductions, which return the partial result over `n` elements of
+//  `x` and `y` with strides `sx` and `sy` in elements
+enum {
+    KERNEL_SUM = 0,  // sum x
+    KERNEL_SUMSQ,    // sum x * x
+    KERNEL_SUMABS,   // sum |x|
+    KERNEL_DOT,      // sum x * y
+    KERNEL_MAX,      // max x, requires n > 0
+    KERNEL_MAXABS,   // max |x|, requires n > 0
+};
+
+double _kernel_reduce_f32(
+    int op,
+    const float *x,
+    Py_ssize_t sx,
+    const float *y,
+    Py_ssize_t sy,
+    Py_ssize_t n);
+
+double _kernel_reduce_f64(
+    int op,
+    const double *x,
+    Py_ssize_t sx,
+    const double *y,
+    Py_ssize_t sy,
+    Py_ssize_t n);
+
+// the copies of at least this many bytes per thread are split across threads
+#define KERNEL_COPY_CHUNK (1 << 20)
+
+// copy the `count` buffers `src` of sizes `len` into `dst`, with up to
+//  `threads` threads (all available if zero)
+void _kernel_gather(
+    char *const *dst,
+    const char *const *src,
+    const Py_ssize_t *len,
+    Py_ssize_t count,
+    unsigned threads);
+
+// copy the rows `indices` of each of the `outer` blocks of `dim` rows of
+//  `inner` bytes in `src` into `dst`, with up to `threads` threads (all
+//  available if zero), the negative indices count from the end of the block
+void _kernel_take(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t outer,
+    Py_ssize_t dim,
+    Py_ssize_t inner,
+    unsigned threads);
+
+// copy the `count` rows of each of the `outer` blocks in `src` into the rows
+//  `indices` of the blocks of `dim` rows of `inner` bytes in `dst`, which is
+//  the inverse of `_kernel_take`, the last of the duplicate indices wins
+void _kernel_put(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t outer,
+    Py_ssize_t dim,
+    Py_ssize_t inner,
+    unsigned threads);
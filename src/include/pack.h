@@ -0,0 +1,17 @@
+PyObject* pack(
+    PyObject *self,
+    PyObject *main);
+
+PyObject* unpack(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs);
+
+PyObject* unflatten_buffer(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs);
+
+extern const PyMethodDef def_pack;
+extern const PyMethodDef def_unpack;
+extern const PyMethodDef def_unflatten_buffer;
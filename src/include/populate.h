@@ -1,12 +1,21 @@
 PyObject* _populate(
     PyObject *iter,
     PyObject *main,
+    PyObject *filler,
+    const bool strict,
+    PyObject *committer);
+
+PyObject* _populate_source(
+    PyObject *source,
+    PyObject *main,
+    PyObject *filler,
     const bool strict,
     PyObject *committer);
 
 PyObject* populate(
     PyObject *self,
-    PyObject *args,
-    PyObject *kwargs);
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
 
 extern const PyMethodDef def_populate;
@@ -2,7 +2,8 @@
 
 PyObject* ragged(
     PyObject *self,
-    PyObject *args,
-    PyObject *kwargs);
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
 
 extern const PyMethodDef def_ragged;
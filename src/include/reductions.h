@@ -0,0 +1,28 @@
+PyObject* sum(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* max(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* dot(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* reduce_norm(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+extern const PyMethodDef def_sum;
+extern const PyMethodDef def_max;
+extern const PyMethodDef def_dot;
+extern const PyMethodDef def_reduce_norm;
@@ -0,0 +1,2 @@
+// a fixed-capacity store of nested records, see `ringbuffer.cpp`
+extern PyTypeObject RingBuffer_Type;
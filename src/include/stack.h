@@ -0,0 +1,14 @@
+PyObject* stack(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* concatenate(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+extern const PyMethodDef def_stack;
+extern const PyMethodDef def_concatenate;
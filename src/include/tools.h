@@ -3,6 +3,31 @@ PyObject *PyObject_CallWithSingleArg(
     PyObject *arg,
     PyObject *kwargs);
 
+PyObject *PyObject_CallWithArgs(
+    PyObject *callable,
+    PyObject *arg,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    PyObject *kwargs);
+
+PyObject *PyObject_CallWithPackedArgs(
+    PyObject *callable,
+    PyObject *arg,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    PyObject *kwargs,
+    PyObject **pool);
+
+PyObject* PyTuple_FromPool(
+    PyObject **pool,
+    PyObject *arg,
+    PyObject *const *rest,
+    Py_ssize_t len);
+
+void PyTuple_ToPool(
+    PyObject **pool,
+    PyObject *args);
+
 PyObject *PyDict_SplitItemStrings(
     PyObject *dict,
     const char *keys[],
@@ -11,8 +36,53 @@ PyObject *PyDict_SplitItemStrings(
 PyObject* PyTuple_Clone(
     PyObject *tuple);
 
+PyObject* PyTuple_FromItems(
+    PyObject *const *items,
+    Py_ssize_t len);
+
+int PyArg_ScanKwnames(
+    const char *fname,
+    PyObject *const *kwvalues,
+    PyObject *kwnames,
+    const char *keys[],
+    PyObject **values,
+    PyObject **kwargs);
+
+int PyArg_ParseFlag(
+    PyObject *value,
+    int *flag);
+
+// the kinds of types of tuples
+enum {
+    TUPLE_PLAIN = 0,
+    TUPLE_NAMEDTUPLE,
+    TUPLE_FOREIGN,
+    // a subtype without `_fields`, the instances of which are checked
+    TUPLE_INSTANCE,
+};
+
+int PyTuple_TypeKind(
+    PyTypeObject *type);
+
+void PyTuple_ClearTypeKinds(void);
+
 int PyNamedTuple_CheckExact(
     PyObject *p);
 
 int PyTupleNamedTuple_CheckExact(
-    PyObject *p);
\ No newline at end of file
+    PyObject *p);
+
+// 3.14 caches the hash of a tuple in the object, which `tuple_subtype_new`
+//  resets, so there namedtuples are filled as plain tuples and made with
+//  the type's `tp_new`, instead of being allocated and filled in place
+#if PY_VERSION_HEX < 0x030E0000
+#   define NAMEDTUPLE_INPLACE
+#endif
+
+PyObject* PyNamedTuple_New(
+    PyTypeObject *type,
+    Py_ssize_t len);
+
+PyObject* PyNamedTuple_Finish(
+    PyTypeObject *type,
+    PyObject *output);
\ No newline at end of file
@@ -0,0 +1,17 @@
+// the list type of the leaves made by `transpose`, see `plyr.cpp`
+extern PyTypeObject AtomicList;
+
+PyObject* transpose(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+PyObject* untranspose(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames);
+
+extern const PyMethodDef def_transpose;
+extern const PyMethodDef def_untranspose;
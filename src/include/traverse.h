@@ -0,0 +1,539 @@
+#include <new>
+#include <unordered_set>
+#include <vector>
+
+// XXX include after `tools.h` and `validate.h`
+
+// Presized dicts and inserting with a hash taken from the source dict are
+//  private API, and the latter is hidden since 3.13, where `PyDict_SetItem`
+//  still reuses the hash cached in `str` keys.
+#if PY_VERSION_HEX < 0x030D0000
+#   define TRAVERSE_KNOWN_HASH
+#endif
+
+// the kinds of nodes met during a traversal of nested objects
+enum {
+    NODE_LEAF = 0,
+    NODE_DICT,
+    NODE_TUPLE,
+    NODE_NAMEDTUPLE,
+    NODE_LIST,
+};
+
+// a container on the path from the root to the current node
+typedef struct {
+    int kind;
+    // the column of the object in a row, which dictates the structure
+    Py_ssize_t index;
+    // the number of children and the position of the next one, which for
+    //  dicts is `PyDict_Next`'s position with an owned ref to the current key
+    Py_ssize_t numel, pos;
+    PyObject *key;
+    // the hash of the current key cached in the main dict
+    Py_hash_t hash;
+    // whether the other dicts have so far had their keys in the same order
+    bool lockstep;
+    // an owned ref to the new container being filled with the results (NULL
+    //  if the traversal does not rebuild the structure)
+    PyObject *output;
+#ifndef NAMEDTUPLE_INPLACE
+    // the type of the namedtuple to be made from the output
+    PyTypeObject *type;
+#endif
+} travframe;
+
+typedef std::vector<travframe> travpath;
+
+
+// the hot steps of the traversal are inlined into the policies
+static inline int _traverse_kind(PyObject *main, const bool strict)
+{
+    // namedtuples are always containers, other subtypes of built-in
+    //  containers are only if not `strict`
+    if(PyDict_CheckExact(main) || (!strict && PyDict_Check(main)))
+        return NODE_DICT;
+
+    if(PyTuple_CheckExact(main))
+        return NODE_TUPLE;
+
+    if(PyNamedTuple_CheckExact(main))
+        return NODE_NAMEDTUPLE;
+
+    if(!strict && PyTuple_Check(main))
+        return NODE_TUPLE;
+
+    if(PyList_CheckExact(main) || (!strict && PyList_Check(main)))
+        return NODE_LIST;
+
+    return NODE_LEAF;
+}
+
+
+static inline int _traverse_validate(
+    int kind,
+    PyObject *const *row,
+    Py_ssize_t len)
+{
+    // check that the other `len` objects in the row are containers of the
+    //  same type and size as the main one, leaving the keys of dicts to be
+    //  validated by `_traverse_next` with `safe` set
+    switch(kind) {
+        case NODE_DICT:
+            return _validate_dict(row[0], row + 1, len, NULL, false);
+
+        case NODE_TUPLE:
+        case NODE_NAMEDTUPLE:
+            return _validate_tuple(row[0], row + 1, len);
+
+        case NODE_LIST:
+            return _validate_list(row[0], row + 1, len);
+    }
+
+    return 1;
+}
+
+
+static inline PyObject* _traverse_new(
+    int kind,
+    PyObject *main,
+    Py_ssize_t numel)
+{
+    // make a new empty container for the `numel` children of `main`
+    switch(kind) {
+        case NODE_DICT:
+            // the output has the same keys, so it never has to be resized
+            return _PyDict_NewPresized(numel);
+
+        case NODE_TUPLE:
+            return PyTuple_New(numel);
+
+        case NODE_NAMEDTUPLE:
+            // namedtuples have the layout of a tuple, so the instance is
+            //  allocated directly and filled in place, bypassing `__new__`,
+            //  where the version of python allows it
+            return PyNamedTuple_New(Py_TYPE(main), numel);
+
+        case NODE_LIST:
+            return PyList_New(numel);
+    }
+
+    return NULL;
+}
+
+
+static inline int _traverse_enter(
+    travframe &frame,
+    PyObject *main,
+    const bool rebuild=true)
+{
+    // prepare to iterate over the children of `main` of `frame.kind`
+    switch(frame.kind) {
+        case NODE_DICT:
+            frame.numel = PyDict_Size(main);
+            break;
+
+        case NODE_TUPLE:
+        case NODE_NAMEDTUPLE:
+            frame.numel = PyTuple_GET_SIZE(main);
+            break;
+
+        case NODE_LIST:
+            frame.numel = PyList_GET_SIZE(main);
+            break;
+
+        default:
+            return 1;
+    }
+
+    PyObject *output = NULL;
+    if(rebuild) {
+        output = _traverse_new(frame.kind, main, frame.numel);
+        if(output == NULL)
+            return 0;
+    }
+
+    frame.pos = 0;
+    frame.key = NULL;
+    frame.lockstep = frame.kind == NODE_DICT;
+    frame.output = output;
+#ifndef NAMEDTUPLE_INPLACE
+    frame.type = Py_TYPE(main);
+#endif
+
+    return 1;
+}
+
+
+static inline int _traverse_lockstep(
+    PyObject *dict,
+    Py_ssize_t pos,
+    PyObject *key,
+    PyObject **value)
+{
+    // Dicts built by the same code have the same order of keys, and thus
+    //  their entries line up: peek at the entry of `dict` at the position of
+    //  `key` in the main dict, and use it if it has the very same key object.
+    PyObject *key_;
+    if(!PyDict_Next(dict, &pos, &key_, value))
+        return 0;
+
+    return key_ == key;
+}
+
+
+static inline int _traverse_next(
+    travframe &frame,
+    PyObject *const *row,
+    PyObject **row_,
+    Py_ssize_t width,
+    const bool broadcast=false,
+    const bool safe=false)
+{
+    // put owned refs to the next children of the objects in `row` into `row_`
+    //  and return 1, unless the container has been exhausted (0) or a key is
+    //  missing (-1). If `broadcast` is set, then only the objects of the same
+    //  type as the main one are descended into, and the others are passed as
+    //  they are. If `safe` is set, then the keys of the dicts are validated
+    //  as they are fetched, since `.enter` has only checked their sizes.
+    PyObject *main = row[frame.index];
+    PyObject *item_;
+
+    switch(frame.kind) {
+        case NODE_DICT: {
+            // Any references returned by `PyDict_Next` are borrowed from the dict
+            //     https://docs.python.org/3/c-api/dict.html#c.PyDict_Next
+            PyObject *key, *main_;
+#ifdef TRAVERSE_KNOWN_HASH
+            if(!_PyDict_Next(main, &frame.pos, &key, &main_, &frame.hash))
+                return 0;
+#else
+            if(!PyDict_Next(main, &frame.pos, &key, &main_))
+                return 0;
+#endif
+
+            // keep the key alive until the child's result is stored
+            Py_INCREF(key);
+            Py_XSETREF(frame.key, key);
+
+            for(Py_ssize_t j = 0; j < width; j++) {
+                if(j == frame.index) {
+                    item_ = main_;
+
+                } else if(broadcast && !Py_IS_TYPE(row[j], Py_TYPE(main))) {
+                    item_ = row[j];
+
+                } else if(
+                    frame.lockstep
+                    && _traverse_lockstep(row[j], frame.pos - 1, key, &item_)
+                ) {
+                    // the item has been found without a lookup
+
+                } else if(!safe) {
+                    // fall back to lookups after the first misaligned key
+                    frame.lockstep = false;
+
+                    // `PyDict_GetItem` returns a borrowed reference
+                    item_ = PyDict_GetItem(row[j], key);
+
+                } else {
+                    frame.lockstep = false;
+
+                    // equal sizes and every key found imply equal key sets,
+                    //  so each key is hashed and probed only once
+                    item_ = PyDict_GetItemWithError(row[j], key);
+                    if(item_ == NULL) {
+                        if(!PyErr_Occurred())
+                            PyErr_SetObject(PyExc_KeyError, key);
+
+                        for(Py_ssize_t k = 0; k < j; k++)
+                            Py_CLEAR(row_[k]);
+
+                        return -1;
+                    }
+                }
+
+                Py_INCREF(item_);
+                row_[j] = item_;
+            }
+
+            return 1;
+        }
+
+        case NODE_TUPLE:
+        case NODE_NAMEDTUPLE:
+        case NODE_LIST: {
+            if(frame.pos >= frame.numel)
+                return 0;
+
+            // tuples and lists share the layout of the items array
+            Py_ssize_t pos = frame.pos++;
+            for(Py_ssize_t j = 0; j < width; j++) {
+                if(broadcast && !Py_IS_TYPE(row[j], Py_TYPE(main))) {
+                    item_ = row[j];
+
+                } else if(frame.kind == NODE_LIST) {
+                    item_ = PyList_GET_ITEM(row[j], pos);
+
+                } else {
+                    item_ = PyTuple_GET_ITEM(row[j], pos);
+
+                }
+
+                Py_INCREF(item_);
+                row_[j] = item_;
+            }
+
+            return 1;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+
+static inline int _traverse_put(
+    const travframe &frame,
+    PyObject *output,
+    PyObject *result)
+{
+    // put the result of the current child of the frame into `output`, which
+    //  was made for the frame's container, stealing the ref to the result
+    switch(frame.kind) {
+        case NODE_DICT: {
+            // dict's setitem does not steal refs to the key and the value
+            int status = 0;
+            if(output != NULL)
+#ifdef TRAVERSE_KNOWN_HASH
+                status = _PyDict_SetItem_KnownHash(
+                    output, frame.key, result, frame.hash);
+#else
+                status = PyDict_SetItem(output, frame.key, result);
+#endif
+
+            Py_DECREF(result);
+
+            return status == 0;
+        }
+
+        case NODE_TUPLE:
+        case NODE_NAMEDTUPLE: {
+            if(output == NULL)
+                break;
+
+            // `PyTuple_SET_ITEM` steals references and does NOT discard refs
+            // of displaced objects, which are none in a NEW (named)tuple
+            PyTuple_SET_ITEM(output, frame.pos - 1, result);
+
+            return 1;
+        }
+
+        case NODE_LIST: {
+            if(output == NULL)
+                break;
+
+            PyList_SET_ITEM(output, frame.pos - 1, result);
+
+            return 1;
+        }
+    }
+
+    Py_DECREF(result);
+
+    return 1;
+}
+
+
+static inline int _traverse_store(
+    travframe &frame,
+    PyObject *result)
+{
+    // put the result of the current child into the frame's own output
+    return _traverse_put(frame, frame.output, result);
+}
+
+
+PyObject* _traverse_finish(
+    travframe &frame,
+    PyObject *finalizer);
+
+void _traverse_release(
+    travpath &frames,
+    std::vector<PyObject *> &rows);
+
+int _traverse_ancestors(
+    const travpath &frames,
+    const std::vector<PyObject *> &rows,
+    Py_ssize_t width,
+    std::unordered_set<PyObject *> &ancestors);
+
+
+// the rows up to this width are assembled on the stack, and the stacks are
+//  reserved for this many levels of nesting
+#define TRAVERSE_SMALL_ROW 8
+#define TRAVERSE_RESERVE 16
+
+// the containers on the path are tracked for reference cycles only past this
+//  depth, which shallow nested objects never reach
+#define TRAVERSE_CYCLE_DEPTH 64
+
+
+template<class Policy>
+PyObject* _traverse(
+    Policy &policy,
+    PyObject *main,
+    PyObject *const *rest,
+    const Py_ssize_t len)
+{
+    // Depth-first traversal of the nested objects with an explicit stack in
+    //  place of recursion, so that the depth is limited by the heap only.
+    // `rows` keeps owned refs to the `width` objects at each node on the path
+    //  from the root, and `frames` -- the containers on it with the partially
+    //  rebuilt outputs. The `policy` decides what a node is on `.enter`, which
+    //  children it has on `.next`, computes the leaves on `.leaf` and
+    //  finalizes the rebuilt containers on `.finish`.
+    const Py_ssize_t width = 1 + len;
+
+    std::vector<PyObject *> rows = {};
+    travpath frames = {};
+
+    PyObject *small[TRAVERSE_SMALL_ROW], **root = small;
+    if(width > TRAVERSE_SMALL_ROW) {
+        try {
+            rows.resize(width);
+
+        } catch(const std::bad_alloc &) {
+            PyErr_NoMemory();
+            return NULL;
+        }
+
+        root = rows.data();
+    }
+
+    root[0] = main;
+    for(Py_ssize_t j = 0; j < len; j++)
+        root[j + 1] = rest[j];
+
+    travframe frame = {NODE_LEAF, 0, 0, 0, NULL, 0, false, NULL};
+    if(!policy.enter(frame, root, frames))
+        return NULL;
+
+    // a leaf at the root needs neither the stacks, nor extra refs
+    if(frame.kind == NODE_LEAF)
+        return policy.leaf(root);
+
+    // the growth of the stacks is the only source of `std::bad_alloc`, which
+    //  is turned into `MemoryError`
+    try {
+        if(root == small)
+            rows.assign(small, small + width);
+
+        // the rows past `used` are spare slots, which are grown on demand
+        rows.resize(TRAVERSE_RESERVE * width, NULL);
+        frames.reserve(TRAVERSE_RESERVE);
+
+    } catch(const std::bad_alloc &) {
+        Py_XDECREF(frame.output);
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    for(Py_ssize_t j = 0; j < width; j++)
+        Py_INCREF(rows[j]);
+
+    frames.push_back(frame);
+
+    size_t used = width;
+
+    // the main objects of the containers on the path past the cycle depth
+    std::unordered_set<PyObject *> ancestors = {};
+
+    PyObject *result;
+    try {
+        for(;;) {
+            // the new frame is pushed without reallocation, so that its refs
+            //  are never lost
+            if(frames.size() == frames.capacity())
+                frames.reserve(2 * frames.size());
+
+            // descend into the next child of the innermost container, if any
+            travframe &top = frames.back();
+
+            size_t base = used - width;
+            if(rows.size() < used + width)
+                rows.resize(2 * rows.size(), NULL);
+
+            int status = policy.next(top, &rows[base], &rows[used]);
+            if(status < 0)
+                break;
+
+            if(status > 0) {
+                base = used;
+                used += width;
+
+                travframe child = {NODE_LEAF, 0, 0, 0, NULL, 0, false, NULL};
+                if(!policy.enter(child, &rows[base], frames))
+                    break;
+
+                if(child.kind != NODE_LEAF) {
+                    frames.push_back(child);
+
+                    // a nested object, which contains itself, is infinitely deep
+                    if(frames.size() > TRAVERSE_CYCLE_DEPTH
+                       && !_traverse_ancestors(frames, rows, width, ancestors))
+                        break;
+
+                    continue;
+                }
+
+                result = policy.leaf(&rows[base]);
+                for(Py_ssize_t j = 0; j < width; j++)
+                    Py_CLEAR(rows[base + j]);
+
+                used = base;
+                if(result == NULL)
+                    break;
+
+                if(!_traverse_store(frames.back(), result))
+                    break;
+
+                continue;
+            }
+
+            // the container has been exhausted: finish it and ascend
+            PyObject *main = rows[base + top.index];
+            result = policy.finish(top, &rows[base]);
+            Py_CLEAR(top.key);
+            frames.pop_back();
+
+            if(frames.size() >= TRAVERSE_CYCLE_DEPTH) {
+                ancestors.erase(main);
+
+            } else if(!ancestors.empty()) {
+                ancestors.clear();
+
+            }
+
+            for(Py_ssize_t j = 0; j < width; j++)
+                Py_CLEAR(rows[base + j]);
+
+            used = base;
+            if(result == NULL)
+                break;
+
+            if(frames.empty())
+                return result;
+
+            if(!_traverse_store(frames.back(), result))
+                break;
+        }
+
+    } catch(const std::bad_alloc &) {
+        PyErr_NoMemory();
+
+    }
+
+    _traverse_release(frames, rows);
+
+    return NULL;
+}
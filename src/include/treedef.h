@@ -0,0 +1,57 @@
+#include <vector>
+
+// the kinds of nodes in a compiled nested structure
+enum {
+    TREEDEF_LEAF = 0,
+    TREEDEF_DICT,
+    TREEDEF_TUPLE,
+    TREEDEF_NAMEDTUPLE,
+    TREEDEF_LIST,
+};
+
+typedef struct {
+    int kind;
+    // the number of immediate children (zero for leaves)
+    Py_ssize_t numel;
+    // owned references to the exact type of the container (NULL for leaves)
+    //  and to the tuple of keys of a dict (NULL otherwise)
+    PyTypeObject *type;
+    PyObject *keys;
+} treenode;
+
+typedef struct {
+    PyObject_HEAD
+    // the nodes of the nested structure in depth-first pre-order
+    std::vector<treenode> *nodes;
+    Py_ssize_t num_leaves;
+    bool strict;
+    // the hash of the structure, or -1 if not computed yet
+    Py_hash_t hash;
+} PyTreeDefObject;
+
+extern PyTypeObject PyTreeDef_Type;
+
+#define PyTreeDef_Check(op) PyObject_TypeCheck(op, &PyTreeDef_Type)
+
+PyObject* _treedef_new(
+    PyObject *main,
+    const bool strict);
+
+PyObject* _treedef_flatten(
+    PyTreeDefObject *self,
+    PyObject *main,
+    const bool safe=true);
+
+PyObject* _treedef_unflatten(
+    PyTreeDefObject *self,
+    PyObject *const *leaves,
+    Py_ssize_t len,
+    PyObject *finalizer=NULL);
+
+PyTreeDefObject* _treedef_cached_gather(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    const bool strict,
+    const bool safe,
+    std::vector<PyObject *> &leaves);
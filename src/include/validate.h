@@ -13,9 +13,24 @@
 
 typedef std::vector<PyObject *> objectstack;
 
-int _validate_dict(PyObject *main, PyObject *rest, objectstack *stack=NULL);
-int _validate_tuple(PyObject *main, PyObject *rest, objectstack *stack=NULL);
-int _validate_list(PyObject *main, PyObject *rest, objectstack *stack=NULL);
+int _validate_dict(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    objectstack *stack=NULL,
+    const bool keys=true);
+
+int _validate_tuple(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    objectstack *stack=NULL);
+
+int _validate_list(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    objectstack *stack=NULL);
 
 int _raise_TypeError(
     Py_ssize_t index,
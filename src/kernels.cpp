@@ -0,0 +1,626 @@
+#include <Python.h>
+#include <cmath>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <kernels.h>
+
+// The kernels are plain loops, which the compiler vectorizes. On x86-64 linux
+//  each kernel is also compiled for AVX2 and AVX-512, and the best version is
+//  picked at load time, since the extension is built for the baseline ISA.
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__) \
+    && defined(__has_attribute)
+#   if __has_attribute(target_clones)
+#       define KERNEL_CLONES \
+            __attribute__((target_clones("avx512f", "avx2", "default")))
+#   endif
+#endif
+
+#ifndef KERNEL_CLONES
+#   define KERNEL_CLONES
+#endif
+
+// the loops are inlined into each clone to be compiled for its ISA
+#if defined(__GNUC__)
+#   define KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#   define KERNEL_INLINE inline
+#endif
+
+
+int _kernel_dtype(const Py_buffer *view)
+{
+    // parse the struct-module format of the buffer, e.g. 'f', '<d' or '=f'
+    //     https://docs.python.org/3/library/struct.html#format-characters
+    const char *format = view->format;
+    if(format == NULL)
+        return KERNEL_NONE;
+
+    switch(*format) {
+        case '@':
+        case '=':
+            format++;
+            break;
+
+#if PY_LITTLE_ENDIAN
+        case '<':
+#else
+        case '>':
+        case '!':
+#endif
+            format++;
+            break;
+    }
+
+    if(format[0] == '\0' || format[1] != '\0')
+        return KERNEL_NONE;
+
+    if(format[0] == 'f' && view->itemsize == sizeof(float))
+        return KERNEL_F32;
+
+    if(format[0] == 'd' && view->itemsize == sizeof(double))
+        return KERNEL_F64;
+
+    return KERNEL_NONE;
+}
+
+
+template<typename T, int OP>
+static KERNEL_INLINE T _kernel_step(T dst, T src, T alpha)
+{
+    switch(OP) {
+        case KERNEL_ADD:
+            return dst + src;
+
+        case KERNEL_SUB:
+            return dst - src;
+
+        case KERNEL_MUL:
+            return dst * src;
+
+        case KERNEL_AXPY:
+            return dst + alpha * src;
+
+        default:
+            return dst + alpha * (src - dst);
+    }
+}
+
+
+template<typename T, int OP>
+static KERNEL_INLINE void _kernel_loop(
+    T *dst,
+    const T *src,
+    T scalar,
+    T alpha,
+    Py_ssize_t n)
+{
+    // `dst` and `src` may be the same buffer, which the vectorizer checks for
+    if(src != NULL) {
+        for(Py_ssize_t j = 0; j < n; j++)
+            dst[j] = _kernel_step<T, OP>(dst[j], src[j], alpha);
+
+    } else {
+        for(Py_ssize_t j = 0; j < n; j++)
+            dst[j] = _kernel_step<T, OP>(dst[j], scalar, alpha);
+
+    }
+}
+
+
+template<typename T>
+static KERNEL_INLINE void _kernel_elementwise(
+    int op,
+    T *dst,
+    const T *src,
+    T scalar,
+    T alpha,
+    Py_ssize_t n)
+{
+    switch(op) {
+        case KERNEL_ADD:
+            _kernel_loop<T, KERNEL_ADD>(dst, src, scalar, alpha, n);
+            break;
+
+        case KERNEL_SUB:
+            _kernel_loop<T, KERNEL_SUB>(dst, src, scalar, alpha, n);
+            break;
+
+        case KERNEL_MUL:
+            _kernel_loop<T, KERNEL_MUL>(dst, src, scalar, alpha, n);
+            break;
+
+        case KERNEL_AXPY:
+            _kernel_loop<T, KERNEL_AXPY>(dst, src, scalar, alpha, n);
+            break;
+
+        case KERNEL_LERP:
+            _kernel_loop<T, KERNEL_LERP>(dst, src, scalar, alpha, n);
+            break;
+    }
+}
+
+
+KERNEL_CLONES
+void _kernel_elementwise_f32(
+    int op,
+    float *dst,
+    const float *src,
+    float scalar,
+    float alpha,
+    Py_ssize_t n)
+{
+    _kernel_elementwise<float>(op, dst, src, scalar, alpha, n);
+}
+
+
+KERNEL_CLONES
+void _kernel_elementwise_f64(
+    int op,
+    double *dst,
+    const double *src,
+    double scalar,
+    double alpha,
+    Py_ssize_t n)
+{
+    _kernel_elementwise<double>(op, dst, src, scalar, alpha, n);
+}
+
+
+// the sums are accumulated in double precision over the blocks of this many
+//  elements, and then the blocks' sums are added pairwise
+#define KERNEL_BLOCK 128
+
+
+template<typename T, int OP>
+static KERNEL_INLINE double _kernel_term(T x, T y)
+{
+    switch(OP) {
+        case KERNEL_SUM:
+            return (double) x;
+
+        case KERNEL_SUMSQ:
+            return (double) x * (double) x;
+
+        case KERNEL_SUMABS:
+            return std::fabs((double) x);
+
+        default:
+            return (double) x * (double) y;
+    }
+}
+
+
+template<typename T, int OP, bool STRIDED>
+static KERNEL_INLINE double _kernel_sum(
+    const T *x,
+    Py_ssize_t sx,
+    const T *y,
+    Py_ssize_t sy,
+    Py_ssize_t n)
+{
+    // Pairwise summation has O(log n) error growth like numpy's `sum`: the sum
+    //  of each new block is merged with the partial sums of the same number
+    //  of blocks, as in adding one to a binary counter, so `partial` never
+    //  holds more than one sum per bit of the number of blocks.
+    double partial[64];
+    int depth = 0;
+
+    Py_ssize_t blocks = 0;
+    for(Py_ssize_t base = 0; base < n; base += KERNEL_BLOCK) {
+        Py_ssize_t end = base + KERNEL_BLOCK < n ? base + KERNEL_BLOCK : n;
+
+        double sum = 0.;
+        if(STRIDED) {
+            for(Py_ssize_t j = base; j < end; j++)
+                sum += _kernel_term<T, OP>(x[j * sx], y[j * sy]);
+
+        } else {
+            for(Py_ssize_t j = base; j < end; j++)
+                sum += _kernel_term<T, OP>(x[j], y[j]);
+
+        }
+
+        for(Py_ssize_t count = blocks++; count & 1; count >>= 1)
+            sum += partial[--depth];
+
+        partial[depth++] = sum;
+    }
+
+    double total = 0.;
+    while(depth > 0)
+        total += partial[--depth];
+
+    return total;
+}
+
+
+// the running max is kept in this many independent lanes, since compilers
+//  vectorize a select over an array, but not a max reduction that has to
+//  propagate NaNs
+#define KERNEL_LANES 16
+
+// a fully unrolled loop over the lanes is left to the SLP vectorizer, which
+//  fails on the selects, so it is kept rolled for the loop vectorizer
+#if defined(__GNUC__) && (__GNUC__ >= 8 || defined(__clang__))
+#   define KERNEL_ROLLED _Pragma("GCC unroll 1")
+#else
+#   define KERNEL_ROLLED
+#endif
+
+
+template<typename T, bool ABS, bool STRIDED>
+static KERNEL_INLINE double _kernel_max(
+    const T *x,
+    Py_ssize_t sx,
+    Py_ssize_t n)
+{
+    // NaNs propagate like in numpy's `max`: each lane keeps any NaN it sees
+    //  in `nan`, apart from the max of the other values in `top`
+    T top[KERNEL_LANES], nan[KERNEL_LANES];
+    for(int l = 0; l < KERNEL_LANES; l++) {
+        top[l] = ABS ? std::fabs(x[0]) : x[0];
+        nan[l] = 0;
+    }
+
+    Py_ssize_t j = 0;
+    for(; j + KERNEL_LANES <= n; j += KERNEL_LANES) {
+        KERNEL_ROLLED
+        for(int l = 0; l < KERNEL_LANES; l++) {
+            T value = STRIDED ? x[(j + l) * sx] : x[j + l];
+            if(ABS)
+                value = std::fabs(value);
+
+            top[l] = value > top[l] ? value : top[l];
+            nan[l] = value != value ? value : nan[l];
+        }
+    }
+
+    for(; j < n; j++) {
+        T value = STRIDED ? x[j * sx] : x[j];
+        if(ABS)
+            value = std::fabs(value);
+
+        top[0] = value > top[0] ? value : top[0];
+        nan[0] = value != value ? value : nan[0];
+    }
+
+    for(int l = 1; l < KERNEL_LANES; l++) {
+        top[0] = top[l] > top[0] ? top[l] : top[0];
+        nan[0] = nan[l] != nan[l] ? nan[l] : nan[0];
+    }
+
+    return (double) (nan[0] != nan[0] ? nan[0] : top[0]);
+}
+
+
+template<typename T>
+static KERNEL_INLINE double _kernel_reduce(
+    int op,
+    const T *x,
+    Py_ssize_t sx,
+    const T *y,
+    Py_ssize_t sy,
+    Py_ssize_t n)
+{
+    // only the dot product reads `y`
+    if(op != KERNEL_DOT) {
+        y = x;
+        sy = sx;
+    }
+
+    bool strided = sx != 1 || sy != 1;
+    switch(op) {
+        case KERNEL_SUM:
+            return strided
+                ? _kernel_sum<T, KERNEL_SUM, true>(x, sx, y, sy, n)
+                : _kernel_sum<T, KERNEL_SUM, false>(x, sx, y, sy, n);
+
+        case KERNEL_SUMSQ:
+            return strided
+                ? _kernel_sum<T, KERNEL_SUMSQ, true>(x, sx, y, sy, n)
+                : _kernel_sum<T, KERNEL_SUMSQ, false>(x, sx, y, sy, n);
+
+        case KERNEL_SUMABS:
+            return strided
+                ? _kernel_sum<T, KERNEL_SUMABS, true>(x, sx, y, sy, n)
+                : _kernel_sum<T, KERNEL_SUMABS, false>(x, sx, y, sy, n);
+
+        case KERNEL_DOT:
+            return strided
+                ? _kernel_sum<T, KERNEL_DOT, true>(x, sx, y, sy, n)
+                : _kernel_sum<T, KERNEL_DOT, false>(x, sx, y, sy, n);
+
+        case KERNEL_MAX:
+            return strided
+                ? _kernel_max<T, false, true>(x, sx, n)
+                : _kernel_max<T, false, false>(x, sx, n);
+
+        default:
+            return strided
+                ? _kernel_max<T, true, true>(x, sx, n)
+                : _kernel_max<T, true, false>(x, sx, n);
+    }
+}
+
+
+KERNEL_CLONES
+double _kernel_reduce_f32(
+    int op,
+    const float *x,
+    Py_ssize_t sx,
+    const float *y,
+    Py_ssize_t sy,
+    Py_ssize_t n)
+{
+    return _kernel_reduce<float>(op, x, sx, y, sy, n);
+}
+
+
+KERNEL_CLONES
+double _kernel_reduce_f64(
+    int op,
+    const double *x,
+    Py_ssize_t sx,
+    const double *y,
+    Py_ssize_t sy,
+    Py_ssize_t n)
+{
+    return _kernel_reduce<double>(op, x, sx, y, sy, n);
+}
+
+
+static unsigned _kernel_threads()
+{
+    // the number of hardware threads is read from the system once, since it
+    //  costs more than a small copy
+    static const unsigned threads = std::thread::hardware_concurrency();
+
+    return threads;
+}
+
+
+static void _kernel_gather_range(
+    char *const *dst,
+    const char *const *src,
+    const Py_ssize_t *len,
+    Py_ssize_t count,
+    Py_ssize_t begin,
+    Py_ssize_t end)
+{
+    // copy the bytes [begin, end) of the concatenation of the buffers
+    Py_ssize_t offset = 0;
+    for(Py_ssize_t j = 0; j < count && offset < end; offset += len[j++]) {
+        Py_ssize_t lo = begin > offset ? begin : offset;
+        Py_ssize_t hi = end < offset + len[j] ? end : offset + len[j];
+        if(lo < hi)
+            std::memcpy(dst[j] + (lo - offset), src[j] + (lo - offset), hi - lo);
+    }
+}
+
+
+void _kernel_gather(
+    char *const *dst,
+    const char *const *src,
+    const Py_ssize_t *len,
+    Py_ssize_t count,
+    unsigned threads)
+{
+    // a single copy is bound by the bandwidth of one core, so large copies
+    //  are split into equal ranges of the bytes, one per thread
+    Py_ssize_t total = 0;
+    for(Py_ssize_t j = 0; j < count; j++)
+        total += len[j];
+
+    if(threads == 0)
+        threads = _kernel_threads();
+
+    if(threads > total / KERNEL_COPY_CHUNK)
+        threads = (unsigned) (total / KERNEL_COPY_CHUNK);
+
+    if(threads < 2) {
+        _kernel_gather_range(dst, src, len, count, 0, total);
+        return;
+    }
+
+    // the calling thread copies the last range, and the ranges of the threads
+    //  that could not be started
+    std::vector<std::thread> pool = {};
+    Py_ssize_t step = total / threads;
+    for(unsigned k = 0; k + 1 < threads; k++) {
+        try {
+            pool.emplace_back(
+                _kernel_gather_range, dst, src, len, count,
+                k * step, (k + 1) * step);
+
+        } catch(const std::system_error &) {
+            break;
+
+        }
+    }
+
+    _kernel_gather_range(dst, src, len, count, pool.size() * step, total);
+
+    for(std::thread &thread : pool)
+        thread.join();
+}
+
+
+template <Py_ssize_t size, bool scatter>
+static KERNEL_INLINE void _kernel_take_rows(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t dim,
+    Py_ssize_t inner)
+{
+    // the rows of a known small size are copied by single moves, and the
+    //  others by `memmove`, since a row may be put into itself
+    if(size > 0)
+        inner = size;
+
+    for(Py_ssize_t j = 0; j < count; j++) {
+        Py_ssize_t pos = indices[j] < 0 ? indices[j] + dim : indices[j];
+        char *out = scatter ? dst + pos * inner : dst + j * inner;
+        const char *in = scatter ? src + j * inner : src + pos * inner;
+        if(size > 0) {
+            std::memcpy(out, in, size);
+
+        } else {
+            std::memmove(out, in, inner);
+
+        }
+    }
+}
+
+
+template <bool scatter>
+static void _kernel_take_range(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t dim,
+    Py_ssize_t inner,
+    Py_ssize_t begin,
+    Py_ssize_t end)
+{
+    // copy the rows [begin, end) of the gathered, or the scattered buffer,
+    //  which has `count` rows in each block
+    Py_ssize_t block = begin / count, j = begin % count;
+    while(begin < end) {
+        Py_ssize_t stop = count < j + (end - begin) ? count : j + (end - begin);
+
+        // the blocks of `dim` rows, and of `count` rows
+        char *out = dst + block * (scatter ? dim : count) * inner;
+        const char *in = src + block * (scatter ? count : dim) * inner;
+        if(scatter) {
+            in += j * inner;
+
+        } else {
+            out += j * inner;
+
+        }
+
+        const Py_ssize_t *ix = indices + j, n = stop - j;
+        switch(inner) {
+            case 1: _kernel_take_rows<1, scatter>(out, in, ix, n, dim, 1); break;
+            case 2: _kernel_take_rows<2, scatter>(out, in, ix, n, dim, 2); break;
+            case 4: _kernel_take_rows<4, scatter>(out, in, ix, n, dim, 4); break;
+            case 8: _kernel_take_rows<8, scatter>(out, in, ix, n, dim, 8); break;
+            case 16: _kernel_take_rows<16, scatter>(out, in, ix, n, dim, 16); break;
+            default: _kernel_take_rows<0, scatter>(out, in, ix, n, dim, inner);
+        }
+
+        begin += stop - j;
+        j = 0;
+        block++;
+    }
+}
+
+
+static bool _kernel_has_repeats(
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t dim)
+{
+    // check if any two of the valid indices refer to the same row
+    std::vector<bool> seen(dim, false);
+    for(Py_ssize_t j = 0; j < count; j++) {
+        Py_ssize_t pos = indices[j] < 0 ? indices[j] + dim : indices[j];
+        if(seen[pos])
+            return true;
+
+        seen[pos] = true;
+    }
+
+    return false;
+}
+
+
+template <bool scatter>
+static void _kernel_take_impl(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t outer,
+    Py_ssize_t dim,
+    Py_ssize_t inner,
+    unsigned threads)
+{
+    // the `count` rows of each block are split into equal ranges, one per
+    //  thread, like the bytes in `_kernel_gather`
+    Py_ssize_t rows = outer * count;
+    if(rows == 0 || inner == 0)
+        return;
+
+    if(threads == 0)
+        threads = _kernel_threads();
+
+    if(threads > rows * inner / KERNEL_COPY_CHUNK)
+        threads = (unsigned) (rows * inner / KERNEL_COPY_CHUNK);
+
+    // the threads would race on the rows put more than once, which are
+    //  written in order instead, so that the last of them wins like in numpy
+    if(scatter && threads > 1 && _kernel_has_repeats(indices, count, dim))
+        threads = 1;
+
+    if(threads < 2) {
+        _kernel_take_range<scatter>(dst, src, indices, count, dim, inner, 0, rows);
+        return;
+    }
+
+    std::vector<std::thread> pool = {};
+    Py_ssize_t step = rows / threads;
+    for(unsigned k = 0; k + 1 < threads; k++) {
+        try {
+            pool.emplace_back(
+                _kernel_take_range<scatter>, dst, src, indices, count, dim,
+                inner, k * step, (k + 1) * step);
+
+        } catch(const std::system_error &) {
+            break;
+
+        }
+    }
+
+    _kernel_take_range<scatter>(
+        dst, src, indices, count, dim, inner, pool.size() * step, rows);
+
+    for(std::thread &thread : pool)
+        thread.join();
+}
+
+
+void _kernel_take(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t outer,
+    Py_ssize_t dim,
+    Py_ssize_t inner,
+    unsigned threads)
+{
+    _kernel_take_impl<false>(
+        dst, src, indices, count, outer, dim, inner, threads);
+}
+
+
+void _kernel_put(
+    char *dst,
+    const char *src,
+    const Py_ssize_t *indices,
+    Py_ssize_t count,
+    Py_ssize_t outer,
+    Py_ssize_t dim,
+    Py_ssize_t inner,
+    unsigned threads)
+{
+    _kernel_take_impl<true>(
+        dst, src, indices, count, outer, dim, inner, threads);
+}
@@ -0,0 +1,311 @@
+#include <Python.h>
+
+#include <multiapply.h>
+#include <validate.h>
+#include <tools.h>
+#include <traverse.h>
+
+
+PyDoc_STRVAR(
+    __doc__,
+    "\n"
+    "multiapply(\n"
+    "    callables,\n"
+    "    *objects,\n"
+    "    _safe=True,\n"
+    "    _star=True,\n"
+    "    _strict=True,\n"
+    "    **kwargs,\n"
+    ")\n"
+    "\n"
+    "Compute several functions on the leaf data of the nested objects in one\n"
+    "traversal, and return a nested object for each function.\n"
+    "\n"
+    "Parameters\n"
+    "----------\n"
+    "callables : sequence of callables\n"
+    "    The callable objects to be applied to the leaf data.\n"
+    "\n"
+    "*objects : nested objects\n"
+    "    All remaining positionals are assumed to be nested objects, that\n"
+    "    supply arguments for the callables from their leaf data.\n"
+    "\n"
+    "_safe, _star, _strict : bool, default=True\n"
+    "    See `.apply`.\n"
+    "\n"
+    "**kwargs : variable keyword arguments\n"
+    "   The optional keyword arguments passed AS IS to every callable.\n"
+    "\n"
+    "Returns\n"
+    "-------\n"
+    "results : tuple of nested objects\n"
+    "    The nested objects with the values returned by each callable, all\n"
+    "    of which have the structure of the first nested object.\n"
+    "\n"
+    "Details\n"
+    "-------\n"
+    "The structure is walked and validated once, and the callables are called\n"
+    "one after another on each leaf, so\n"
+    "\n"
+    ">>> mean, var = multiapply((np.mean, np.var), tree)\n"
+    "\n"
+    "is equivalent to, but faster than\n"
+    "\n"
+    ">>> mean, var = apply(np.mean, tree), apply(np.var, tree)\n"
+    "\n"
+);
+
+
+// the policy of `_traverse` for `multiapply`, which rebuilds the structure
+//  once for each callable, and thus keeps the outputs by itself
+struct multiapplier {
+    PyObject *const *callables;
+    Py_ssize_t count;
+    bool safe, star, strict;
+    PyObject *kwargs;
+
+    // the number of objects besides the main one
+    Py_ssize_t len;
+
+    // the containers on the path from the root, see `_traverse`
+    const travpath *path;
+
+    // owned refs to the `count` outputs of each container on the path, the
+    //  last of which is the innermost one
+    std::vector<PyObject *> outputs;
+
+    // the results of the callables on a leaf, or the finished outputs
+    std::vector<PyObject *> results;
+
+    // an owned ref to the recycled tuple of arguments for `star=False`
+    PyObject *pool;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        this->path = &path;
+
+        PyObject *main = row[0];
+        frame.kind = _traverse_kind(main, strict);
+        if(safe && len > 0 && !_traverse_validate(frame.kind, row, len))
+            return 0;
+
+        if(!_traverse_enter(frame, main, false))
+            return 0;
+
+        if(frame.kind == NODE_LEAF)
+            return 1;
+
+        // the partially made outputs are released by `_multiapply` on error
+        for(Py_ssize_t j = 0; j < count; j++) {
+            PyObject *output = _traverse_new(frame.kind, main, frame.numel);
+            if(output == NULL)
+                return 0;
+
+            outputs.push_back(output);
+        }
+
+        return 1;
+    }
+
+    PyObject* store(const travframe *parent)
+    {
+        // put the `results` into the outputs of the parent container, or
+        //  pack them into a tuple at the root, stealing the refs
+        size_t base = outputs.size() - count;
+        if(parent == NULL) {
+            PyObject *tuple = PyTuple_New(count);
+            for(Py_ssize_t j = 0; j < count; j++) {
+                if(tuple != NULL) {
+                    PyTuple_SET_ITEM(tuple, j, results[j]);
+
+                } else {
+                    Py_DECREF(results[j]);
+
+                }
+            }
+
+            return tuple;
+        }
+
+        int status = 1;
+        for(Py_ssize_t j = 0; j < count; j++) {
+            if(status) {
+                status = _traverse_put(*parent, outputs[base + j], results[j]);
+
+            } else {
+                Py_DECREF(results[j]);
+
+            }
+        }
+
+        if(!status)
+            return NULL;
+
+        Py_RETURN_NONE;
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        // in tuple-apply the same tuple of arguments is given to each callable
+        PyObject *args = NULL;
+        if(!star) {
+            args = PyTuple_FromPool(&pool, row[0], row + 1, len);
+            if(args == NULL)
+                return NULL;
+        }
+
+        for(Py_ssize_t j = 0; j < count; j++) {
+            PyObject *result;
+            if(star) {
+                result = PyObject_CallWithArgs(
+                    callables[j], row[0], row + 1, len, kwargs);
+
+            } else {
+                result = PyObject_CallWithSingleArg(callables[j], args, kwargs);
+
+            }
+
+            if(result == NULL) {
+                for(Py_ssize_t i = 0; i < j; i++)
+                    Py_DECREF(results[i]);
+
+                if(args != NULL)
+                    PyTuple_ToPool(&pool, args);
+
+                return NULL;
+            }
+
+            results[j] = result;
+        }
+
+        if(args != NULL)
+            PyTuple_ToPool(&pool, args);
+
+        return store(path->empty() ? NULL : &path->back());
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1 + len, false, safe);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        // the finished container is still on the path, so its outputs are
+        //  taken off it to be stored into the outputs of its parent
+        size_t base = outputs.size() - count;
+        for(Py_ssize_t j = 0; j < count; j++)
+            results[j] = outputs[base + j];
+
+        outputs.resize(base);
+#ifndef NAMEDTUPLE_INPLACE
+        if(frame.kind == NODE_NAMEDTUPLE) {
+            int status = 1;
+            for(Py_ssize_t j = 0; j < count; j++) {
+                results[j] = PyNamedTuple_Finish(Py_TYPE(row[0]), results[j]);
+                status = status && results[j] != NULL;
+            }
+
+            if(!status) {
+                for(Py_ssize_t j = 0; j < count; j++)
+                    Py_XDECREF(results[j]);
+
+                return NULL;
+            }
+        }
+#endif
+
+        size_t depth = path->size();
+        return store(depth > 1 ? &(*path)[depth - 2] : NULL);
+    }
+};
+
+
+static PyObject* _multiapply(
+    PyObject *const *callables,
+    Py_ssize_t count,
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    const bool safe,
+    const bool star,
+    const bool strict,
+    PyObject *kwargs)
+{
+    multiapplier policy = {
+        callables, count, safe, star, strict, kwargs, len, NULL, {}, {}, NULL};
+    policy.results.resize(count, NULL);
+
+    PyObject *result = _traverse(policy, main, rest, len);
+    for(PyObject *output : policy.outputs)
+        Py_DECREF(output);
+
+    Py_XDECREF(policy.pool);
+
+    return result;
+}
+
+
+PyObject* multiapply(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    int safe = 1, star = 1, strict = 1;
+
+    // `multiapply(callables, main, *rest, _safe, _star, _strict, **kwargs)`
+    if(nargs < 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "multiapply() takes at least 2 arguments (%zd given)", nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"_safe", "_star", "_strict", NULL};
+
+    PyObject *own[] = {NULL, NULL, NULL};
+    PyObject *kwargs = NULL, *callables = NULL, *result = NULL;
+    if(!PyArg_ScanKwnames(
+        "multiapply", args + nargs, kwnames, kwlist, own, &kwargs
+    ))
+        return NULL;
+
+    if(
+        !PyArg_ParseFlag(own[0], &safe) || !PyArg_ParseFlag(own[1], &star)
+        || !PyArg_ParseFlag(own[2], &strict)
+    )
+        goto finally;
+
+    // an immutable copy, since the callables may change the sequence
+    callables = PySequence_Tuple(args[0]);
+    if(callables == NULL)
+        goto finally;
+
+    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(callables); j++) {
+        if(!PyCallable_Check(PyTuple_GET_ITEM(callables, j))) {
+            PyErr_SetString(
+                PyExc_TypeError,
+                "The first argument must be a sequence of callables.");
+            goto finally;
+        }
+    }
+
+    result = _multiapply(
+        &PyTuple_GET_ITEM(callables, 0), PyTuple_GET_SIZE(callables),
+        args[1], args + 2, nargs - 2, safe, star, strict, kwargs);
+
+finally:
+    Py_XDECREF(callables);
+    Py_XDECREF(kwargs);
+
+    return result;
+}
+
+
+const PyMethodDef def_multiapply = {
+    "multiapply",
+    (PyCFunction) (void(*)(void)) multiapply,
+    METH_FASTCALL | METH_KEYWORDS,
+    __doc__,
+};
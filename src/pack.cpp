@@ -0,0 +1,574 @@
+#include <Python.h>
+#include <cstring>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <populate.h>
+#include <pack.h>
+
+
+// the policy of `_traverse` for `pack`
+struct packer {
+    // the acquired views of the leaves in depth-first order
+    std::vector<Py_buffer> views;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], true);
+
+        return _traverse_enter(frame, row[0]);
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        // the leaves of the skeleton are None
+        Py_buffer view;
+        if(PyObject_GetBuffer(row[0], &view, PyBUF_RECORDS_RO) < 0) {
+            PyErr_Format(
+                PyExc_TypeError, "The leaves must be buffers, not '%s'",
+                Py_TYPE(row[0])->tp_name);
+            return NULL;
+        }
+
+        views.push_back(view);
+
+        Py_RETURN_NONE;
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+
+    void release()
+    {
+        for(Py_buffer &view : views)
+            PyBuffer_Release(&view);
+
+        views.clear();
+    }
+};
+
+
+static PyObject* _pack_layout(
+    PyObject *skeleton,
+    const std::vector<Py_buffer> &views,
+    const std::vector<Py_ssize_t> &offsets)
+{
+    // the layout is `(skeleton, ((offset, format, itemsize, shape), ...))`
+    PyObject *entries = PyTuple_New(views.size());
+    if(entries == NULL)
+        return NULL;
+
+    for(size_t j = 0; j < views.size(); j++) {
+        const Py_buffer &view = views[j];
+
+        PyObject *shape = PyTuple_New(view.ndim);
+        if(shape == NULL) {
+            Py_DECREF(entries);
+            return NULL;
+        }
+
+        for(int k = 0; k < view.ndim; k++) {
+            PyObject *dim = PyLong_FromSsize_t(view.shape[k]);
+            if(dim == NULL) {
+                Py_DECREF(shape);
+                Py_DECREF(entries);
+                return NULL;
+            }
+
+            PyTuple_SET_ITEM(shape, k, dim);
+        }
+
+        PyObject *entry = Py_BuildValue(
+            "(nsnN)", offsets[j], view.format == NULL ? "B" : view.format,
+            view.itemsize, shape);
+        if(entry == NULL) {
+            Py_DECREF(entries);
+            return NULL;
+        }
+
+        PyTuple_SET_ITEM(entries, j, entry);
+    }
+
+    return Py_BuildValue("(ON)", skeleton, entries);
+}
+
+
+static PyObject* _pack(PyObject *main)
+{
+    packer policy = {{}};
+
+    PyObject *skeleton = _traverse(policy, main, NULL, 0);
+    if(skeleton == NULL) {
+        policy.release();
+        return NULL;
+    }
+
+    // each leaf is aligned to its itemsize, and the flat buffer has the
+    //  format of the leaves, if they all have the same one, or is bytes
+    std::vector<Py_buffer> &views = policy.views;
+    std::vector<Py_ssize_t> offsets(views.size(), 0);
+
+    bool same = !views.empty();
+    Py_ssize_t total = 0;
+    for(size_t j = 0; j < views.size(); j++) {
+        Py_ssize_t itemsize = views[j].itemsize > 0 ? views[j].itemsize : 1;
+        offsets[j] = (total + itemsize - 1) / itemsize * itemsize;
+        total = offsets[j] + views[j].len;
+
+        same = same && views[j].itemsize == views[0].itemsize
+            && _ops_same_format(_ops_format(views[j]), _ops_format(views[0]));
+    }
+
+    PyObject *result = NULL, *layout = NULL, *flat = NULL;
+    OpsBufferObject *data = _ops_buffer_new(
+        same ? _ops_format(views[0]) : "B",
+        same ? views[0].itemsize : 1, 1, total, NULL);
+    if(data == NULL)
+        goto finally;
+
+    data->shape[0] = total / data->itemsize;
+    _ops_buffer_strides(data);
+
+    {
+        // the strided leaves are copied right away, the padding is zeroed,
+        //  and the contiguous leaves are copied by `_kernel_gather`
+        std::vector<char *> dst = {};
+        std::vector<const char *> src = {};
+        std::vector<Py_ssize_t> len = {};
+
+        Py_ssize_t end = 0;
+        for(size_t j = 0; j < views.size(); j++) {
+            memset(data->data + end, 0, offsets[j] - end);
+            end = offsets[j] + views[j].len;
+
+            if(!PyBuffer_IsContiguous(&views[j], 'C')) {
+                if(PyBuffer_ToContiguous(
+                    data->data + offsets[j], &views[j], views[j].len, 'C'
+                ) < 0)
+                    goto finally;
+
+            } else {
+                dst.push_back(data->data + offsets[j]);
+                src.push_back((const char *) views[j].buf);
+                len.push_back(views[j].len);
+
+            }
+        }
+
+        if(total < KERNEL_NOGIL_SIZE * (Py_ssize_t) sizeof(double)) {
+            _kernel_gather(dst.data(), src.data(), len.data(), dst.size(), 1);
+
+        } else {
+            Py_BEGIN_ALLOW_THREADS
+            _kernel_gather(dst.data(), src.data(), len.data(), dst.size(), 0);
+            Py_END_ALLOW_THREADS
+        }
+    }
+
+    layout = _pack_layout(skeleton, views, offsets);
+    if(layout == NULL)
+        goto finally;
+
+    flat = PyMemoryView_FromObject((PyObject *) data);
+    if(flat != NULL)
+        result = PyTuple_Pack(2, flat, layout);
+
+finally:
+    policy.release();
+    Py_XDECREF(flat);
+    Py_XDECREF(layout);
+    Py_XDECREF(data);
+    Py_DECREF(skeleton);
+
+    return result;
+}
+
+
+PyObject* pack(PyObject *self, PyObject *main)
+{
+    return _pack(main);
+}
+
+
+static int _ops_parse_shape(
+    PyObject *shape,
+    Py_ssize_t itemsize,
+    std::vector<Py_ssize_t> &dims,
+    Py_ssize_t &nbytes)
+{
+    // read the sequence of non-negative ints into `dims`, and get the size
+    //  of the C-contiguous array of this shape in bytes
+    PyObject *seq = PySequence_Fast(shape, "The shape must be a sequence.");
+    if(seq == NULL)
+        return 0;
+
+    Py_ssize_t ndim = PySequence_Fast_GET_SIZE(seq);
+    if(itemsize < 1 || ndim > PyBUF_MAX_NDIM) {
+        PyErr_SetString(PyExc_ValueError, "Invalid itemsize or shape of a leaf.");
+        Py_DECREF(seq);
+        return 0;
+    }
+
+    dims.resize(ndim);
+    nbytes = itemsize;
+    for(Py_ssize_t k = 0; k < ndim; k++) {
+        dims[k] = PyNumber_AsSsize_t(
+            PySequence_Fast_GET_ITEM(seq, k), PyExc_OverflowError);
+        if(dims[k] == -1 && PyErr_Occurred()) {
+            Py_DECREF(seq);
+            return 0;
+        }
+
+        if(dims[k] < 0 || (dims[k] > 0 && nbytes > PY_SSIZE_T_MAX / dims[k])) {
+            PyErr_SetString(PyExc_ValueError, "Invalid shape of a leaf.");
+            Py_DECREF(seq);
+            return 0;
+        }
+
+        nbytes *= dims[k];
+    }
+
+    Py_DECREF(seq);
+
+    return 1;
+}
+
+
+static PyObject* _unpack_leaf(
+    PyObject *flat,
+    const Py_buffer &arena,
+    int flags,
+    PyObject *entry)
+{
+    // a memoryview of the leaf described by the entry of the layout
+    Py_ssize_t offset, itemsize;
+    const char *format;
+    PyObject *shape;
+    if(!PyTuple_Check(entry)) {
+        PyErr_SetString(PyExc_TypeError, "The entries of the layout must be tuples.");
+        return NULL;
+    }
+
+    if(!PyArg_ParseTuple(
+        entry, "nsnO!;The entries of the layout must be "
+        "(offset, format, itemsize, shape)",
+        &offset, &format, &itemsize, &PyTuple_Type, &shape
+    ))
+        return NULL;
+
+    std::vector<Py_ssize_t> dims = {};
+    Py_ssize_t nbytes = 0;
+    if(!_ops_parse_shape(shape, itemsize, dims, nbytes))
+        return NULL;
+
+    if(offset < 0 || offset > arena.len || nbytes > arena.len - offset) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "The leaf at %zd of %zd bytes is out of the flat buffer of %zd bytes",
+            offset, nbytes, arena.len);
+        return NULL;
+    }
+
+    return _ops_view(flat, flags, offset, format, itemsize, dims);
+}
+
+
+static PyObject* _unpack(PyObject *flat, PyObject *layout)
+{
+    PyObject *skeleton, *entries;
+    if(!PyTuple_Check(layout)) {
+        PyErr_SetString(PyExc_TypeError, "The layout must be a tuple.");
+        return NULL;
+    }
+
+    if(!PyArg_ParseTuple(
+        layout, "OO!;The layout must be a pair (skeleton, entries)",
+        &skeleton, &PyTuple_Type, &entries
+    ))
+        return NULL;
+
+    // the views are writable, if the flat buffer is
+    int flags = PyBUF_RECORDS;
+    Py_buffer arena;
+    if(PyObject_GetBuffer(flat, &arena, flags) < 0) {
+        PyErr_Clear();
+        flags = PyBUF_RECORDS_RO;
+        if(PyObject_GetBuffer(flat, &arena, flags) < 0)
+            return NULL;
+    }
+
+    PyObject *leaves = NULL, *iter = NULL, *result = NULL, *extra = NULL;
+    if(!PyBuffer_IsContiguous(&arena, 'C')) {
+        PyErr_SetString(PyExc_ValueError, "The flat buffer must be C-contiguous.");
+        goto finally;
+    }
+
+    leaves = PyList_New(PyTuple_GET_SIZE(entries));
+    if(leaves == NULL)
+        goto finally;
+
+    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(entries); j++) {
+        PyObject *leaf = _unpack_leaf(
+            flat, arena, flags, PyTuple_GET_ITEM(entries, j));
+        if(leaf == NULL)
+            goto finally;
+
+        PyList_SET_ITEM(leaves, j, leaf);
+    }
+
+    // the views are put into the skeleton like by `populate`, and all of
+    //  them must be used
+    iter = PyObject_GetIter(leaves);
+    if(iter == NULL)
+        goto finally;
+
+    result = _populate(iter, skeleton, NULL, true, NULL);
+    if(result == NULL) {
+        if(PyErr_ExceptionMatches(PyExc_StopIteration)) {
+            PyErr_SetString(
+                PyExc_ValueError, "The layout has fewer entries than leaves.");
+        }
+
+        goto finally;
+    }
+
+    extra = PyIter_Next(iter);
+    if(extra != NULL) {
+        PyErr_SetString(
+            PyExc_ValueError, "The layout has more entries than leaves.");
+        Py_CLEAR(result);
+
+    } else if(PyErr_Occurred()) {
+        Py_CLEAR(result);
+
+    }
+
+finally:
+    Py_XDECREF(extra);
+    Py_XDECREF(iter);
+    Py_XDECREF(leaves);
+    PyBuffer_Release(&arena);
+
+    return result;
+}
+
+
+PyObject* unpack(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    if(nargs != 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "unpack() takes exactly 2 positional arguments (%zd given)", nargs);
+        return NULL;
+    }
+
+    return _unpack(args[0], args[1]);
+}
+
+
+// the policy of `_traverse` for `unflatten_buffer`
+struct unflattener {
+    PyObject *flat;
+    const Py_buffer *arena;
+    int flags;
+
+    // the offset of the next leaf in bytes
+    Py_ssize_t offset;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], true);
+
+        return _traverse_enter(frame, row[0]);
+    }
+
+    int shape(PyObject *leaf, std::vector<Py_ssize_t> &dims, Py_ssize_t &nbytes);
+
+    PyObject* leaf(PyObject **row)
+    {
+        std::vector<Py_ssize_t> dims = {};
+        Py_ssize_t nbytes = 0;
+        if(!shape(row[0], dims, nbytes))
+            return NULL;
+
+        if(nbytes > arena->len - offset) {
+            PyErr_Format(
+                PyExc_ValueError,
+                "The buffer of %zd bytes is too short for the shapes",
+                arena->len);
+            return NULL;
+        }
+
+        PyObject *view = _ops_view(
+            flat, flags, offset, arena->format == NULL ? "B" : arena->format,
+            arena->itemsize, dims);
+        offset += nbytes;
+
+        return view;
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+int unflattener::shape(PyObject *leaf, std::vector<Py_ssize_t> &dims, Py_ssize_t &nbytes)
+{
+    // the shape of a leaf is an int, the shape of a buffer, e.g. of the
+    //  current value of the parameter, or a sequence of ints, which is not
+    //  a built-in tuple or list, e.g. `torch.Size` or `plyr.AtomicTuple`
+    if(PyIndex_Check(leaf) && !PySequence_Check(leaf)) {
+        Py_ssize_t dim = PyNumber_AsSsize_t(leaf, PyExc_OverflowError);
+        if(dim == -1 && PyErr_Occurred())
+            return 0;
+
+        if(dim < 0 || dim > PY_SSIZE_T_MAX / arena->itemsize) {
+            PyErr_SetString(PyExc_ValueError, "Invalid shape of a leaf.");
+            return 0;
+        }
+
+        dims.assign(1, dim);
+        nbytes = dim * arena->itemsize;
+
+        return 1;
+    }
+
+    Py_buffer view;
+    if(PyObject_GetBuffer(leaf, &view, PyBUF_RECORDS_RO) < 0) {
+        PyErr_Clear();
+        return _ops_parse_shape(leaf, arena->itemsize, dims, nbytes);
+    }
+
+    dims.assign(view.shape, view.shape + view.ndim);
+    PyBuffer_Release(&view);
+
+    nbytes = arena->itemsize;
+    for(Py_ssize_t dim : dims) {
+        if(dim > 0 && nbytes > PY_SSIZE_T_MAX / dim) {
+            PyErr_SetString(PyExc_ValueError, "Invalid shape of a leaf.");
+            return 0;
+        }
+
+        nbytes *= dim;
+    }
+
+    return 1;
+}
+
+
+PyObject* unflatten_buffer(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs)
+{
+    // `unflatten_buffer(flat, struct, /)`
+    if(nargs != 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "unflatten_buffer() takes exactly 2 positional arguments "
+            "(%zd given)", nargs);
+        return NULL;
+    }
+
+    // the views are writable, if the flat buffer is
+    int flags = PyBUF_RECORDS;
+    Py_buffer arena;
+    if(PyObject_GetBuffer(args[0], &arena, flags) < 0) {
+        PyErr_Clear();
+        flags = PyBUF_RECORDS_RO;
+        if(PyObject_GetBuffer(args[0], &arena, flags) < 0)
+            return NULL;
+    }
+
+    PyObject *result = NULL;
+    if(!PyBuffer_IsContiguous(&arena, 'C')) {
+        PyErr_SetString(PyExc_ValueError, "The flat buffer must be C-contiguous.");
+
+    } else {
+        unflattener policy = {args[0], &arena, flags, 0};
+
+        result = _traverse(policy, args[1], NULL, 0);
+        if(result != NULL && policy.offset != arena.len) {
+            PyErr_Format(
+                PyExc_ValueError,
+                "The buffer has %zd bytes, but the shapes take %zd",
+                arena.len, policy.offset);
+            Py_CLEAR(result);
+        }
+
+    }
+
+    PyBuffer_Release(&arena);
+
+    return result;
+}
+
+
+const PyMethodDef def_pack = {
+    "pack",
+    (PyCFunction) pack,
+    METH_O,
+    PyDoc_STR(
+        "pack(struct)\n"
+        "\n"
+        "Copy the buffers in the leaves of the nested object into one new\n"
+        "flat C-contiguous buffer in depth-first order, each aligned to its\n"
+        "itemsize. Returns a pair `(flat, layout)` of a memoryview of the\n"
+        "flat buffer, which has the format of the leaves if they all have\n"
+        "the same one, and is bytes otherwise, and of the layout for\n"
+        "`unpack`, a tuple `(skeleton, entries)` of the structure with None\n"
+        "leaves and of `(offset, format, itemsize, shape)` of each leaf.\n"
+    ),
+};
+
+
+const PyMethodDef def_unpack = {
+    "unpack",
+    (PyCFunction) (void(*)(void)) unpack,
+    METH_FASTCALL,
+    PyDoc_STR(
+        "unpack(flat, layout)\n"
+        "\n"
+        "Rebuild the nested object packed by `pack` with memoryviews into\n"
+        "the C-contiguous `flat` buffer as its leaves, which have the\n"
+        "original formats and shapes, and share the memory of `flat`, e.g.\n"
+        "to update all leaves at once by a single operation on `flat`. The\n"
+        "views are writable if `flat` is.\n"
+    ),
+};
+
+
+const PyMethodDef def_unflatten_buffer = {
+    "unflatten_buffer",
+    (PyCFunction) (void(*)(void)) unflatten_buffer,
+    METH_FASTCALL,
+    PyDoc_STR(
+        "unflatten_buffer(flat, struct)\n"
+        "\n"
+        "Split the C-contiguous `flat` buffer, e.g. the parameter vector of\n"
+        "L-BFGS or CMA-ES, into consecutive zero-copy views with the shapes\n"
+        "in the leaves of `struct`, and return them in its structure. The\n"
+        "shape of a leaf is an int, the shape of a buffer, e.g. the current\n"
+        "value of the parameter, or a sequence of ints other than a plain\n"
+        "tuple or list, e.g. `torch.Size`. The views have the format of\n"
+        "`flat` and are writable if it is, and the shapes must take all\n"
+        "of its elements.\n"
+    ),
+};
@@ -6,8 +6,23 @@
 
 #include <ragged.h>
 #include <populate.h>
+#include <reduce.h>
+#include <multiapply.h>
+#include <chainapply.h>
+#include <transpose.h>
+#include <treedef.h>
 #include <tools.h>
 
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <elementwise.h>
+#include <reductions.h>
+#include <stack.h>
+#include <take.h>
+#include <pack.h>
+#include <ringbuffer.h>
+
 
 PyDoc_STRVAR(
     __doc__,
@@ -19,120 +34,102 @@ PyDoc_STRVAR(
 
 // apply functions with preset _safe and _star kwargs
 // [ts][u_]apply -- t/s tuple or star args, u/_ unsafe or safe
-static PyObject* suply(PyObject *self, PyObject *args, PyObject *kwargs)
+// XXX each calls its own specialization of `_apply_with`
+template<int SAFE, int STAR>
+static PyObject* _ply(
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
 {
-    PyObject *callable = NULL, *main = NULL, *rest = NULL;
-    if(!parse_apply_args(args, &callable, &main, &rest))
+    PyObject *callable = NULL, *main = NULL, *kwargs = NULL;
+    if(!parse_apply_args(args, nargs, &callable, &main))
         return NULL;
 
-    PyObject *result = _apply(callable, main, rest, 0, 1, kwargs, NULL, 1, NULL);
-    Py_DECREF(rest);
-
-    return result;
-}
+    // all keywords are passed along to the callable
+    static const char *kwlist[] = {NULL};
 
+    PyObject *result = NULL;
+    if(PyArg_ScanKwnames("apply", args + nargs, kwnames, kwlist, NULL, &kwargs))
+        result = _apply_with<SAFE, STAR, APPLY_ON, APPLY_OFF, APPLY_OFF>(
+            callable, main, args + 2, nargs - 2, SAFE, STAR, kwargs, NULL, 1, NULL);
 
-static PyObject* tuply(PyObject *self, PyObject *args, PyObject *kwargs)
-{
-    PyObject *callable = NULL, *main = NULL, *rest = NULL;
-    if(!parse_apply_args(args, &callable, &main, &rest))
-        return NULL;
-
-    PyObject *result = _apply(callable, main, rest, 0, 0, kwargs, NULL, 1, NULL);
-    Py_DECREF(rest);
+    Py_XDECREF(kwargs);
 
     return result;
 }
 
 
-static PyObject* s_ply(PyObject *self, PyObject *args, PyObject *kwargs)
+static PyObject* suply(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
-    PyObject *callable = NULL, *main = NULL, *rest = NULL;
-    if(!parse_apply_args(args, &callable, &main, &rest))
-        return NULL;
+    return _ply<APPLY_OFF, APPLY_ON>(args, nargs, kwnames);
+}
 
-    PyObject *result = _apply(callable, main, rest, 1, 1, kwargs, NULL, 1, NULL);
-    Py_DECREF(rest);
 
-    return result;
+static PyObject* tuply(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ply<APPLY_OFF, APPLY_OFF>(args, nargs, kwnames);
 }
 
 
-static PyObject* t_ply(PyObject *self, PyObject *args, PyObject *kwargs)
+static PyObject* s_ply(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
-    PyObject *callable = NULL, *main = NULL, *rest = NULL;
-    if(!parse_apply_args(args, &callable, &main, &rest))
-        return NULL;
+    return _ply<APPLY_ON, APPLY_ON>(args, nargs, kwnames);
+}
 
-    PyObject *result = _apply(callable, main, rest, 1, 0, kwargs, NULL, 1, NULL);
-    Py_DECREF(rest);
 
-    return result;
+static PyObject* t_ply(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _ply<APPLY_ON, APPLY_OFF>(args, nargs, kwnames);
 }
 
 
-static PyObject* flatapply(PyObject *self, PyObject *args, PyObject *kwargs)
+static PyObject* flatapply(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
 {
     int star = 1;
-    PyObject *callable = NULL, *main = NULL, *rest = NULL;
-    if(!parse_apply_args(args, &callable, &main, &rest))
+    PyObject *callable = NULL, *main = NULL, *kwargs = NULL;
+    if(!parse_apply_args(args, nargs, &callable, &main))
         return NULL;
 
-    if (kwargs) {
-        static const char *kwlist[] = {
-            "_star",
-            NULL,
-        };
-
-        PyObject* own = PyDict_SplitItemStrings(kwargs, kwlist, true);
-        if (own == NULL) {
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        PyObject *empty = PyTuple_New(0);
-        if (empty == NULL) {
-            Py_DECREF(own);
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        int parsed = PyArg_ParseTupleAndKeywords(
-            empty, own, "|$p:apply", (char**) kwlist, &star);
-
-        Py_DECREF(empty);
-        if (!parsed) {
-            Py_DECREF(own);
-            Py_DECREF(rest);
-            return NULL;
-        }
-
-        Py_DECREF(own);
-    }
+    static const char *kwlist[] = {
+        "_star",
+        NULL,
+    };
+
+    PyObject *own[] = {NULL};
+    PyObject *list = NULL, *append = NULL, *result = NULL, *tuple = NULL;
+    if(!PyArg_ScanKwnames("flatapply", args + nargs, kwnames, kwlist, own, &kwargs))
+        goto finally;
+
+    if(!PyArg_ParseFlag(own[0], &star))
+        goto finally;
 
     // get the `.append` method of a new list to which the leaves are added
-    PyObject *list = PyList_New(0);
-    if(list == NULL) {
-        Py_DECREF(rest);
-        return NULL;
-    }
+    list = PyList_New(0);
+    if(list == NULL)
+        goto finally;
 
-    PyObject *append = PyObject_GetAttrString(list, "append");
-    if(append == NULL) {
-        Py_DECREF(list);
-        Py_DECREF(rest);
-        return NULL;
-    }
+    append = PyObject_GetAttrString(list, "append");
+    if(append == NULL)
+        goto finally;
 
     // force safe and strict flags
-    PyObject *result = _apply(callable, main, rest, 1, star, kwargs, NULL, 1, append);
-    Py_DECREF(append);
-    Py_DECREF(rest);
+    result = _apply_with<APPLY_ON, APPLY_ANY, APPLY_ON, APPLY_OFF, APPLY_ON>(
+        callable, main, args + 2, nargs - 2, 1, star, kwargs, NULL, 1, append);
 
     // value builder creates new references
-    PyObject *tuple = Py_BuildValue("(OO)", list, result);
+    if(result != NULL)
+        tuple = Py_BuildValue("(OO)", list, result);
+
+finally:
     Py_XDECREF(result);
-    Py_DECREF(list);
+    Py_XDECREF(append);
+    Py_XDECREF(list);
+    Py_XDECREF(kwargs);
 
     return tuple;
 }
@@ -143,36 +140,36 @@ static PyMethodDef modplyr_methods[] = {
     def_validate,
     {
         "suply",
-        (PyCFunction) suply,
-        METH_VARARGS | METH_KEYWORDS,
+        (PyCFunction) (void(*)(void)) suply,
+        METH_FASTCALL | METH_KEYWORDS,
         PyDoc_STR(
             "Strict star-apply without safety checks (use at your own risk)."
         ),
     }, {
         "tuply",
-        (PyCFunction) tuply,
-        METH_VARARGS | METH_KEYWORDS,
+        (PyCFunction) (void(*)(void)) tuply,
+        METH_FASTCALL | METH_KEYWORDS,
         PyDoc_STR(
             "Strict tuple-apply without safety checks (use at your own risk)."
         ),
     }, {
         "s_ply",
-        (PyCFunction) s_ply,
-        METH_VARARGS | METH_KEYWORDS,
+        (PyCFunction) (void(*)(void)) s_ply,
+        METH_FASTCALL | METH_KEYWORDS,
         PyDoc_STR(
             "Strict star-apply with safety checks."
         ),
     }, {
         "t_ply",
-        (PyCFunction) t_ply,
-        METH_VARARGS | METH_KEYWORDS,
+        (PyCFunction) (void(*)(void)) t_ply,
+        METH_FASTCALL | METH_KEYWORDS,
         PyDoc_STR(
             "Strict tuple-apply with safety checks."
         ),
     }, {
         "flatapply",
-        (PyCFunction) flatapply,
-        METH_VARARGS | METH_KEYWORDS,
+        (PyCFunction) (void(*)(void)) flatapply,
+        METH_FASTCALL | METH_KEYWORDS,
         PyDoc_STR(
             "flatapply(callable, *objects, _star=True, **kwargs)\n"
             "\n"
@@ -221,6 +218,29 @@ static PyMethodDef modplyr_methods[] = {
 
     def_ragged,
     def_populate,
+    def_reduce,
+    def_multiapply,
+    def_chainapply,
+    def_transpose,
+    def_untranspose,
+
+    // the numeric operations re-exported by `plyr.ops`
+    def_add,
+    def_sub,
+    def_mul,
+    def_axpy,
+    def_lerp,
+    def_sum,
+    def_max,
+    def_dot,
+    def_reduce_norm,
+    def_stack,
+    def_concatenate,
+    def_take,
+    def_put,
+    def_pack,
+    def_unpack,
+    def_unflatten_buffer,
     {
         NULL,
         NULL,
@@ -230,12 +250,22 @@ static PyMethodDef modplyr_methods[] = {
 };
 
 
+static void modplyr_free(void *module)
+{
+    PyTuple_ClearTypeKinds();
+}
+
+
 static struct PyModuleDef moduledef = {
         PyModuleDef_HEAD_INIT,
         "base",
         __doc__,
         -1,
         modplyr_methods,
+        NULL,
+        NULL,
+        NULL,
+        modplyr_free,
 };
 
 
@@ -284,7 +314,8 @@ static PyTypeObject AtomicTuple = {
 };
 
 
-static PyTypeObject AtomicList = {
+// not static, since `transpose` makes its leaves
+PyTypeObject AtomicList = {
     PyVarObject_HEAD_INIT(NULL, 0)
     "plyr.AtomicList",              /* tp_name */
     sizeof(PyListObject),           /* tp_basicsize */
@@ -386,7 +417,10 @@ PyInit_base(void)
     if (
         PyType_Ready(&AtomicTuple) < 0 ||
         PyType_Ready(&AtomicList) < 0 ||
-        PyType_Ready(&AtomicDict) < 0
+        PyType_Ready(&AtomicDict) < 0 ||
+        PyType_Ready(&PyTreeDef_Type) < 0 ||
+        PyType_Ready(&OpsBuffer_Type) < 0 ||
+        PyType_Ready(&RingBuffer_Type) < 0
     )
         return NULL;
 
@@ -421,6 +455,22 @@ PyInit_base(void)
         init_failed = true;
     }
 
+    Py_INCREF(&PyTreeDef_Type);
+    if (
+        PyModule_AddObject(mod, "TreeDef", (PyObject *) &PyTreeDef_Type) < 0
+    ) {
+        Py_DECREF(&PyTreeDef_Type);
+        init_failed = true;
+    }
+
+    Py_INCREF(&RingBuffer_Type);
+    if (
+        PyModule_AddObject(mod, "RingBuffer", (PyObject *) &RingBuffer_Type) < 0
+    ) {
+        Py_DECREF(&RingBuffer_Type);
+        init_failed = true;
+    }
+
     // do not need to decref created types since either thery have been stolen
     // by AddObject on success, or have already been decrefed on failure
     if(init_failed) {
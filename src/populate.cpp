@@ -1,152 +1,327 @@
 #include <Python.h>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
 
 #include <populate.h>
+#include <validate.h>
 #include <tools.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
 
 PyDoc_STRVAR(
     __doc__,
-    "Populate the specified struct from an iterator.\n"
+    "populate(struct, source, /, *, default, _committer, _strict)\n"
+    "\n"
+    "Populate the specified struct from the source, which is an iterator,\n"
+    "a list or a tuple, which are read by position without an iterator,\n"
+    "or a buffer, e.g. a numpy array, the leaves from which are the python\n"
+    "numbers of a 1d buffer or the items `source[k]` of a buffer with more\n"
+    "dims, e.g. the zero-copy views of its rows. The rows of memoryviews and\n"
+    "of other buffers without item access are zero-copy memoryviews, and\n"
+    "require the buffer to be C-contiguous. A list, a tuple or a buffer with\n"
+    "fewer items than the leaves raises StopIteration before any leaf is\n"
+    "committed, unless `default` is given.\n"
 );
 
 
-PyObject* _populate(
-    PyObject *iter,
-    PyObject *main,
-    PyObject *filler,
-    const bool strict,
-    PyObject *committer);
+// the sources of the leaf data of `_populate`
+enum {
+    POPULATE_ITER = 0,
+    POPULATE_ITEMS,
+    POPULATE_BUFFER,
+};
 
 
-static PyObject* _populate_dict(
-    PyObject *iter,
-    PyObject *main,
-    PyObject *filler,
-    const bool strict,
-    PyObject *committer)
+static PyObject* _populate_ordered(
+    const char *format,
+    const char *item,
+    Py_ssize_t itemsize)
 {
-    PyObject *key, *main_;
-    PyObject *output = PyDict_New(), *result = NULL;
-    if(output == NULL) {
+    // the python number of the element with the byte order of the struct
+    //  module prefix, e.g. `<i` or `!d`, or NULL with no error set for the
+    //  other formats. The size is the itemsize of the buffer, which is the
+    //  standard size of the format for the struct module, e.g. 4 bytes for
+    //  `=l`, but the native one for numpy and ctypes, e.g. 8 bytes for `<l`.
+#if PY_LITTLE_ENDIAN
+    const bool swap = format[0] == '>' || format[0] == '!';
+#else
+    const bool swap = format[0] == '<';
+#endif
+
+    const char code = format[1];
+    if(strchr("bBhHiIlLqQ?fd", code) == NULL)
         return NULL;
+
+    if(itemsize != 1 && itemsize != 2 && itemsize != 4 && itemsize != 8)
+        return NULL;
+
+    if((code == 'f' && itemsize != 4) || (code == 'd' && itemsize != 8))
+        return NULL;
+
+    // the bytes in the native order, zero- or sign-extended to 8 bytes
+    uint64_t bits = 0;
+    unsigned char *bytes = (unsigned char *) &bits;
+    for(Py_ssize_t k = 0; k < itemsize; k++) {
+        Py_ssize_t j = swap ? itemsize - 1 - k : k;
+#if PY_LITTLE_ENDIAN
+        bytes[k] = (unsigned char) item[j];
+#else
+        bytes[8 - itemsize + k] = (unsigned char) item[j];
+#endif
     }
 
-    Py_ssize_t pos = 0;
-    while (PyDict_Next(main, &pos, &key, &main_)) {
-        result = _populate(iter, main_, filler, strict, committer);
-        if(result == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
+    if(code == 'f') {
+        float x;
+        uint32_t low = (uint32_t) bits;
+        memcpy(&x, &low, 4);
+        return PyFloat_FromDouble(x);
+    }
+
+    if(code == 'd') {
+        double x;
+        memcpy(&x, &bits, 8);
+        return PyFloat_FromDouble(x);
+    }
 
-        PyDict_SetItem(output, key, result);
+    if(code == '?')
+        return PyBool_FromLong(bits != 0);
 
-        Py_DECREF(result);
+    // the signed codes are lowercase
+    if(code >= 'a' && itemsize < 8) {
+        uint64_t sign = (uint64_t) 1 << (8 * itemsize - 1);
+        bits = (bits ^ sign) - sign;
     }
 
-    return output;
+    if(code >= 'a')
+        return PyLong_FromLongLong((long long) bits);
+
+    return PyLong_FromUnsignedLongLong((unsigned long long) bits);
 }
 
 
-static PyObject* _populate_tuple(
-    PyObject *iter,
-    PyObject *main,
-    PyObject *filler,
-    const bool strict,
-    PyObject *committer)
+static PyObject* _populate_scalar(
+    const Py_buffer &view,
+    Py_ssize_t pos,
+    Py_ssize_t stride)
 {
-    PyObject *main_;
-    Py_ssize_t numel = PyTuple_GET_SIZE(main);
-    PyObject *output = PyTuple_New(numel), *result = NULL;
-    if(output == NULL) {
+    // the python number of the element of a 1d buffer with a single item
+    //  format, or NULL with no error set for the other formats
+    const char *format = view.format == NULL ? "B" : view.format;
+    const char *item = (const char *) view.buf + pos * stride;
+
+    // the sizes of `=`, `<`, `>` and `!` formats are not the native ones
+    if(format[0] != '\0' && strchr("=<>!", format[0]) != NULL) {
+        if(format[1] == '\0' || format[2] != '\0')
+            return NULL;
+
+        return _populate_ordered(format, item, view.itemsize);
+    }
+
+    if(*format == '@')
+        format++;
+
+    if(format[0] == '\0' || format[1] != '\0')
         return NULL;
+
+#define POPULATE_CASE(code, type, convert) \
+    case code: { type x; memcpy(&x, item, sizeof(type)); return convert(x); }
+
+    switch(format[0]) {
+        POPULATE_CASE('b', signed char, PyLong_FromLong)
+        POPULATE_CASE('B', unsigned char, PyLong_FromUnsignedLong)
+        POPULATE_CASE('h', short, PyLong_FromLong)
+        POPULATE_CASE('H', unsigned short, PyLong_FromUnsignedLong)
+        POPULATE_CASE('i', int, PyLong_FromLong)
+        POPULATE_CASE('I', unsigned int, PyLong_FromUnsignedLong)
+        POPULATE_CASE('l', long, PyLong_FromLong)
+        POPULATE_CASE('L', unsigned long, PyLong_FromUnsignedLong)
+        POPULATE_CASE('q', long long, PyLong_FromLongLong)
+        POPULATE_CASE('Q', unsigned long long, PyLong_FromUnsignedLongLong)
+        POPULATE_CASE('n', Py_ssize_t, PyLong_FromSsize_t)
+        POPULATE_CASE('N', size_t, PyLong_FromSize_t)
+        POPULATE_CASE('f', float, PyFloat_FromDouble)
+        POPULATE_CASE('d', double, PyFloat_FromDouble)
+        POPULATE_CASE('?', bool, PyBool_FromLong)
     }
 
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        main_ = PyTuple_GET_ITEM(main, pos);
-        result = _populate(iter, main_, filler, strict, committer);
-        if(result == NULL) {
-            Py_DECREF(output);
+#undef POPULATE_CASE
+
+    return NULL;
+}
+
+
+// the policy of `_traverse`, which counts the leaves up to a limit, and
+//  raises StopIteration past it
+struct leafcounter {
+    bool strict;
+    Py_ssize_t limit;
+
+    // the number of leaves so far
+    Py_ssize_t count;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], strict);
+
+        return _traverse_enter(frame, row[0], false);
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        if(++count > limit) {
+            PyErr_Format(
+                PyExc_StopIteration,
+                "The source has %zd items, fewer than the leaves.", limit);
             return NULL;
         }
 
-        PyTuple_SET_ITEM(output, pos, result);
+        Py_RETURN_NONE;
     }
 
-    if(PyTuple_CheckExact(main))
-        return output;
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
 
-    // Preserve namedtuple, devolve others to built-in tuples
-    if(!PyNamedTuple_CheckExact(main))
-        return output;
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        Py_RETURN_NONE;
+    }
+};
 
-    // since `namedtuple`-s are immutable and derived from `tuple`, we can
-    //  just call `tp_new` on them
-    // XXX fix this if the namedtuple's implementation changes
-    // https://docs.python.org/3/c-api/typeobj.html#c.PyTypeObject.tp_new
-    PyObject *namedtuple = Py_TYPE(main)->tp_new(Py_TYPE(main), output, NULL);
-    Py_DECREF(output);
 
-    return namedtuple;
-}
+// the policy of `_traverse` for `populate`, which takes the leaf data from
+//  the source one by one in depth-first order
+struct populator {
+    int mode;
+    PyObject *source, *filler;
+    bool strict;
+    PyObject *committer;
 
+    // the view of a buffer source, and the flags of the zero-copy views of
+    //  its rows, or zero if the rows are the items of the source
+    const Py_buffer *view;
+    int flags;
 
-static PyObject* _populate_list(
-    PyObject *iter,
-    PyObject *main,
-    PyObject *filler,
-    const bool strict,
-    PyObject *committer)
-{
-    PyObject *main_;
-    Py_ssize_t numel = PyList_GET_SIZE(main);
-    PyObject *output = PyList_New(numel), *result = NULL;
-    if(output == NULL) {
-        return NULL;
+    // the stride of the first dim, which some exporters, e.g. ctypes, leave
+    //  to be computed from the shape
+    Py_ssize_t stride;
+
+    // the next position in a list, tuple or buffer source
+    Py_ssize_t pos;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], strict);
+
+        return _traverse_enter(frame, row[0]);
     }
 
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        main_ = PyList_GET_ITEM(main, pos);
-        result = _populate(iter, main_, filler, strict, committer);
-        if(result == NULL) {
-            Py_DECREF(output);
+    PyObject* fetch()
+    {
+        // a new ref to the next item of the source, or NULL with no error
+        //  set if there are no remaining items
+        if(mode == POPULATE_ITER)
+            return PyIter_Next(source);
+
+        // the size of a list is read each time, since the committer may
+        //  change the list
+        if(mode == POPULATE_ITEMS) {
+            if(pos >= PySequence_Fast_GET_SIZE(source))
+                return NULL;
+
+            PyObject *item = PySequence_Fast_GET_ITEM(source, pos++);
+            Py_INCREF(item);
+            return item;
+        }
+
+        if(pos >= view->shape[0])
             return NULL;
+
+        Py_ssize_t j = pos++;
+        if(view->ndim == 1) {
+            PyObject *item = _populate_scalar(*view, j, stride);
+            if(item != NULL || PyErr_Occurred())
+                return item;
         }
 
-        PyList_SET_ITEM(output, pos, result);
+        if(flags != 0)
+            return fetch_row(j);
+
+        // the items of the buffers with more dims are made by the exporter
+        PyObject *item = PySequence_GetItem(source, j);
+        if(item == NULL && PyErr_ExceptionMatches(PyExc_IndexError))
+            PyErr_SetString(PyExc_RuntimeError, "The buffer source has changed.");
+
+        return item;
     }
 
-    return output;
-}
+    PyObject* fetch_row(Py_ssize_t j)
+    {
+        // a zero-copy memoryview of the j-th row of a C-contiguous buffer
+        std::vector<Py_ssize_t> dims(view->shape + 1, view->shape + view->ndim);
 
+        return _ops_view(
+            source, flags, j * stride,
+            view->format == NULL ? "B" : view->format, view->itemsize, dims);
+    }
 
-static PyObject* _populate_base(
-    PyObject *iter,
-    PyObject *filler,
-    PyObject *committer)
-{
-    // If there are no remaining values, _next returns NULL with no exception set,
-    PyObject *output = PyIter_Next(iter);
-    if(output == NULL && !PyErr_Occurred()) {
-        if(filler == NULL) {
-            // indicate that we've been exhausted with the StopIteration
-            PyErr_SetNone(PyExc_StopIteration);
-
-        } else {
-            // continue populating with the provided filler value
-            output = filler;
-            Py_INCREF(output);
+    PyObject* leaf(PyObject **row)
+    {
+        // If there are no remaining values, fetch returns NULL with no
+        //  exception set
+        PyObject *output = fetch();
+        if(output == NULL && !PyErr_Occurred()) {
+            if(filler == NULL) {
+                // indicate that we've been exhausted with the StopIteration
+                PyErr_SetNone(PyExc_StopIteration);
+
+            } else {
+                // continue populating with the provided filler value
+                output = filler;
+                Py_INCREF(output);
+            }
         }
+
+        // bypass the committer if fetch failed and bubble up the exception
+        if(committer == NULL || output == NULL)
+            return output;
+
+        // The committer is only called on the leaf data
+        PyObject *result = PyObject_CallWithSingleArg(committer, output, NULL);
+        Py_DECREF(output);
+
+        return result;
     }
 
-    // bypass the finalizer if _populate_* failed and bubble up the exception
-    if(committer == NULL || output == NULL)
-        return output;
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
 
-    // The committer is only called on the leaf data
-    PyObject *result = PyObject_CallWithSingleArg(committer, output, NULL);
-    Py_DECREF(output);
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
 
-    return result;
+
+static int _populate_check(
+    PyObject *main,
+    Py_ssize_t numel,
+    const bool strict)
+{
+    // make sure there are at least as many items as leaves, before any leaf
+    //  is committed. Without a committer a short source is simply detected
+    //  at the leaf it runs out on, since populating has no side effects.
+    leafcounter policy = {strict, numel, 0};
+
+    PyObject *result = _traverse(policy, main, NULL, 0);
+    Py_XDECREF(result);
+
+    return result != NULL;
 }
 
 
@@ -157,64 +332,132 @@ PyObject* _populate(
     const bool strict,
     PyObject *committer)
 {
-    PyObject *result;
+    populator policy = {
+        POPULATE_ITER, iter, filler, strict, committer, NULL, 0, 0, 0};
+
+    return _traverse(policy, main, NULL, 0);
+}
 
-    if(PyDict_CheckExact(main) || (!strict && PyDict_Check(main))) {
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _populate_dict(iter, main, filler, strict, committer);
-        Py_LeaveRecursiveCall();
+
+PyObject* _populate_source(
+    PyObject *source,
+    PyObject *main,
+    PyObject *filler,
+    const bool strict,
+    PyObject *committer)
+{
+    // lists and tuples, including their subclasses, e.g. namedtuples, are read
+    //  by position without an iterator
+    if(PyList_Check(source) || PyTuple_Check(source)) {
+        Py_ssize_t numel = PySequence_Fast_GET_SIZE(source);
+        if(
+            filler == NULL && committer != NULL
+            && !_populate_check(main, numel, strict)
+        )
+            return NULL;
+
+        populator policy = {
+            POPULATE_ITEMS, source, filler, strict, committer, NULL, 0, 0, 0};
+
+        return _traverse(policy, main, NULL, 0);
+    }
+
+    if(PyIter_Check(source))
+        return _populate(source, main, filler, strict, committer);
+
+    // the buffer is held for the duration of the traversal, and the views of
+    //  the rows are writable, if it is
+    int flags = PyBUF_RECORDS;
+    Py_buffer view;
+    if(PyObject_GetBuffer(source, &view, flags) < 0) {
+        PyErr_Clear();
+        flags = PyBUF_RECORDS_RO;
+        if(PyObject_GetBuffer(source, &view, flags) < 0) {
+            PyErr_SetString(
+                PyExc_TypeError,
+                "The source must be an iterator, a list, a tuple or a buffer.");
+            return NULL;
+        }
+    }
+
+    // the rows of memoryviews with more dims and of the buffers without item
+    //  access are made here, since the exporter cannot make them
+    if(view.ndim < 2 || !(PyMemoryView_Check(source) || !PySequence_Check(source)))
+        flags = 0;
+
+    PyObject *result = NULL;
+    if(view.ndim < 1) {
+        PyErr_SetString(
+            PyExc_TypeError, "The buffer source must have at least one dim.");
+
+    } else if(flags != 0 && !PyBuffer_IsContiguous(&view, 'C')) {
+        PyErr_SetString(
+            PyExc_TypeError,
+            "The rows of a memoryview source with more than one dim are made"
+            " only for C-contiguous buffers.");
 
     } else if(
-        PyTupleNamedTuple_CheckExact(main) || (!strict && PyTuple_Check(main))
+        filler != NULL || committer == NULL
+        || _populate_check(main, view.shape[0], strict)
     ) {
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _populate_tuple(iter, main, filler, strict, committer);
-        Py_LeaveRecursiveCall();
+        Py_ssize_t stride = view.strides != NULL ? view.strides[0] : view.itemsize;
+        for(int k = 1; view.strides == NULL && k < view.ndim; k++)
+            stride *= view.shape[k];
 
-    } else if(PyList_CheckExact(main) || (!strict && PyList_Check(main))) {
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _populate_list(iter, main, filler, strict, committer);
-        Py_LeaveRecursiveCall();
+        populator policy = {
+            POPULATE_BUFFER, source, filler, strict, committer,
+            &view, flags, stride, 0};
+
+        result = _traverse(policy, main, NULL, 0);
 
-    } else {
-        return _populate_base(iter, filler, committer);
     }
 
+    PyBuffer_Release(&view);
+
     return result;
 }
 
 
-PyObject* populate(PyObject *self, PyObject *args, PyObject *kwargs)
+PyObject* populate(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
 {
-
-    PyObject *iter = NULL, *main = NULL, *committer=NULL, *filler=NULL;
     int strict=1;
 
-    static const char *kwlist[] = {"", "", "default", "_committer", "_strict", NULL};
-    if(!PyArg_ParseTupleAndKeywords(
-        args, kwargs,
-        "OO|$OOp:populate", (char**) kwlist,
-        &main, &iter, &filler, &committer, &strict
-    ))
+    // `populate(main, source, /, *, default, _committer, _strict)`
+    if(nargs != 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "populate() takes exactly 2 positional arguments (%zd given)", nargs);
         return NULL;
+    }
+
+    PyObject *main = args[0], *source = args[1];
+
+    static const char *kwlist[] = {"default", "_committer", "_strict", NULL};
 
-    if(!PyIter_Check(iter)) {
-        PyErr_SetString(PyExc_TypeError, "The second argument must be an iterator.");
+    PyObject *own[] = {NULL, NULL, NULL};
+    if(!PyArg_ScanKwnames("populate", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    if(!PyArg_ParseFlag(own[2], &strict))
         return NULL;
-    }
 
+    PyObject *filler = own[0], *committer = own[1];
     if(committer != NULL && !PyCallable_Check(committer)) {
         PyErr_SetString(PyExc_TypeError, "The committer must be a callable.");
         return NULL;
     }
 
-    return _populate(iter, main, filler, strict, committer);
+    return _populate_source(source, main, filler, strict, committer);
 }
 
 
 const PyMethodDef def_populate = {
     "populate",
-    (PyCFunction) populate,
-    METH_VARARGS | METH_KEYWORDS,
+    (PyCFunction) (void(*)(void)) populate,
+    METH_FASTCALL | METH_KEYWORDS,
     __doc__,
 };
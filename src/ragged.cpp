@@ -3,6 +3,7 @@
 #include <ragged.h>
 #include <validate.h>
 #include <tools.h>
+#include <traverse.h>
 
 
 PyDoc_STRVAR(
@@ -21,336 +22,123 @@ PyDoc_STRVAR(
 );
 
 
-PyObject* _ragged(
-    PyObject *callable,
-    PyObject *objects,
-    PyObject *kwargs,
-    const bool star,
-    PyObject *finalizer);
-
-
-PyObject* _ragged_dict(
-    PyObject *callable,
-    PyObject *args,
-    PyObject *kwargs,
-    const bool star,
-    PyObject *finalizer,
-    const std::vector<Py_ssize_t> &indices)
-{
-    PyObject *main = PyTuple_GET_ITEM(args, indices[0]);
-
-    PyObject *output = PyDict_New();
-    if(output == NULL)
-        return NULL;
-
-    Py_ssize_t pos = 0;
-    PyObject *key, *item_, *main_;
-    while(PyDict_Next(main, &pos, &key, &main_)) {
-        // clone the args and replace containers with their respective items
-        // We used to reuse the same single tuple object, but it doesn't work
-        //  correctly, since the object calling protocol implies that the args
-        //  can be simply increfed instead of being copied
-        PyObject *args_ = PyTuple_Clone(args);
-        if(args_ == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        Py_INCREF(main_);
-        PyTuple_SetItem(args_, indices[0], main_);
-        for(size_t k = 1; k < indices.size() ; k++) {
-            Py_ssize_t j = indices[k];
-            item_ = PyDict_GetItem(PyTuple_GET_ITEM(args_, j), key);
-
-            Py_INCREF(item_);
-            PyTuple_SetItem(args_, j, item_);
-        }
-
-        PyObject *result = _ragged(callable, args_, kwargs, star, finalizer);
-        Py_DECREF(args_);
-
-        if(result == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        PyDict_SetItem(output, key, result);
-        Py_DECREF(result);
-    }
-
-    return output;
-}
-
-
-int _validate_dict(
-    PyObject *args, 
-    const std::vector<Py_ssize_t> &indices)
+static int _validate_ragged(
+    PyObject *const *row,
+    Py_ssize_t width,
+    Py_ssize_t index)
 {
-    PyObject *main = PyTuple_GET_ITEM(args, indices[0]);
-
-    Py_ssize_t numel = PyDict_Size(main);
-    for(size_t k = 1; k < indices.size() ; k++) {
-        Py_ssize_t j = indices[k];
+    // the containers in the row must have the same type and size as the main
+    //  one, and, if they are dicts, the same keys, which are checked by `.next`
+    PyObject *main = row[index];
 
-        PyObject *obj = PyTuple_GET_ITEM(args, j), *key, *item;
+    Py_ssize_t numel = PyDict_Check(main) ? PyDict_Size(main) : Py_SIZE(main);
+    for(Py_ssize_t j = index + 1; j < width; j++) {
+        PyObject *obj = row[j];
+        if(!(PyDict_Check(obj) || PyTuple_Check(obj) || PyList_Check(obj)))
+            continue;
 
         if(!Py_IS_TYPE(obj, Py_TYPE(main)))
             return _raise_TypeError(j, main, obj, NULL);
 
-        if(numel != PyDict_Size(obj))
+        if(numel != (PyDict_Check(main) ? PyDict_Size(obj) : Py_SIZE(obj)))
             return _raise_SizeError(j, main, NULL);
-
-        Py_ssize_t pos = 0;
-        while (PyDict_Next(main, &pos, &key, &item)) {
-            if(!PyDict_Contains(obj, key)) {
-                PyErr_SetObject(PyExc_KeyError, key);
-
-                return 0;
-            }
-        }
     }
 
     return 1;
 }
 
 
-PyObject* _ragged_list(
-    PyObject *callable,
-    PyObject *args,
-    PyObject *kwargs,
-    const bool star,
-    PyObject *finalizer,
-    const std::vector<Py_ssize_t> &indices)
-{
-    PyObject *main = PyTuple_GET_ITEM(args, indices[0]);
+// the policy of `_traverse` for `ragged`, see `_ragged`
+struct broadcaster {
+    PyObject *callable, *kwargs;
+    bool star;
+    PyObject *finalizer;
 
-    Py_ssize_t numel = PyList_GET_SIZE(main);
-    PyObject *output = PyList_New(numel), *result;
-    if(output == NULL)
-        return NULL;
-
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        PyObject *args_ = PyTuple_Clone(args);
-        if(args_ == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
+    // the number of objects in a row
+    Py_ssize_t width;
 
-        for(Py_ssize_t j : indices) {
-            PyObject *item_ = PyList_GET_ITEM(PyTuple_GET_ITEM(args_, j), pos);
+    // an owned ref to the recycled tuple of arguments for `star=False`
+    PyObject *pool;
 
-            Py_INCREF(item_);
-            PyTuple_SetItem(args_, j, item_);
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        // the first container in the row dictates the structure
+        for(frame.index = 0; frame.index < width; frame.index++) {
+            PyObject *item_ = row[frame.index];
+            if(PyDict_Check(item_) || PyTuple_Check(item_) || PyList_Check(item_))
+                break;
         }
 
-        result = _ragged(callable, args_, kwargs, star, finalizer);
-        Py_DECREF(args_);
+        if(frame.index == width)
+            return 1;
 
-        if(result == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
+        PyObject *main = row[frame.index];
+        frame.kind = _traverse_kind(main, false);
+        if(!_validate_ragged(row, width, frame.index))
+            return 0;
 
-        // not decrefing `result`, since List steals ref
-        PyList_SET_ITEM(output, pos, result);
+        return _traverse_enter(frame, main);
     }
 
-    return output;
-}
-
-
-int _validate_list(
-    PyObject *args, 
-    const std::vector<Py_ssize_t> &indices)
-{
-    PyObject *main = PyTuple_GET_ITEM(args, indices[0]);
-
-    Py_ssize_t numel = PyList_GET_SIZE(main);
-    for(size_t k = 1; k < indices.size() ; k++) {
-        Py_ssize_t j = indices[k];
-
-        PyObject *obj = PyTuple_GET_ITEM(args, j);
-
-        if(!Py_IS_TYPE(obj, Py_TYPE(main)))
-            return _raise_TypeError(j, main, obj, NULL);
+    PyObject* leaf(PyObject **row)
+    {
+        if (star)
+            return PyObject_CallWithArgs(callable, row[0], row + 1, width - 1, kwargs);
 
-        if(numel != PyList_GET_SIZE(obj))
-            return _raise_SizeError(j, main, NULL);
+        return PyObject_CallWithPackedArgs(
+            callable, row[0], row + 1, width - 1, kwargs, &pool);
     }
 
-    return 1;
-}
-
-
-PyObject* _ragged_tuple(
-    PyObject *callable,
-    PyObject *args,
-    PyObject *kwargs,
-    const bool star,
-    PyObject *finalizer,
-    const std::vector<Py_ssize_t> &indices)
-{
-    PyObject *main = PyTuple_GET_ITEM(args, indices[0]);
-
-    Py_ssize_t numel = PyList_GET_SIZE(main);
-    PyObject *output = PyTuple_New(numel), *result;
-    if(output == NULL)
-        return NULL;
-
-    for(Py_ssize_t pos = 0; pos < numel; pos++) {
-        PyObject *args_ = PyTuple_Clone(args);
-        if(args_ == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        for(Py_ssize_t j : indices) {
-            PyObject *item_ = PyTuple_GET_ITEM(PyTuple_GET_ITEM(args_, j), pos);
-
-            Py_INCREF(item_);
-            PyTuple_SetItem(args_, j, item_);
-        }
-
-        result = _ragged(callable, args_, kwargs, star, finalizer);
-        Py_DECREF(args_);
-
-        if(result == NULL) {
-            Py_DECREF(output);
-            return NULL;
-        }
-
-        PyTuple_SET_ITEM(output, pos, result);
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        // non-containers are broadcasted into the children
+        return _traverse_next(frame, row, row_, width, true, true);
     }
 
-    if(PyTuple_CheckExact(main))
-        return output;
-
-    if(!PyNamedTuple_CheckExact(main))
-        return output;
-
-    PyObject *namedtuple = Py_TYPE(main)->tp_new(Py_TYPE(main), output, NULL);
-    Py_DECREF(output);
-
-    return namedtuple;
-}
-
-
-int _validate_tuple(
-    PyObject *args, 
-    const std::vector<Py_ssize_t> &indices)
-{
-    PyObject *main = PyTuple_GET_ITEM(args, indices[0]);
-
-    Py_ssize_t numel = PyTuple_GET_SIZE(main);
-    for(size_t k = 1; k < indices.size() ; k++) {
-        Py_ssize_t j = indices[k];
-
-        PyObject *obj = PyTuple_GET_ITEM(args, j);
-
-        if(!Py_IS_TYPE(obj, Py_TYPE(main)))
-            return _raise_TypeError(j, main, obj, NULL);
-
-        if(numel != PyTuple_GET_SIZE(obj))
-            return _raise_SizeError(j, main, NULL);
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, finalizer);
     }
-
-    return 1;
-}
+};
 
 
 PyObject* _ragged(
     PyObject *callable,
-    PyObject *args,
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
     PyObject *kwargs,
     const bool star,
     PyObject *finalizer)
 {
-    std::vector<Py_ssize_t> indices = {};
-    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(args); j++) {
-        PyObject *item_ = PyTuple_GET_ITEM(args, j);
-        if(PyDict_Check(item_) || PyTuple_Check(item_) || PyList_Check(item_)) {
-            indices.push_back(j);
-        }
-    }
-
-    if(indices.empty()) {
-        if (star) {
-            return PyObject_Call(callable, args, kwargs);
-        } else {
-            return PyObject_CallWithSingleArg(callable, args, kwargs);
-        }
-    }
+    broadcaster policy = {callable, kwargs, star, finalizer, 1 + len, NULL};
 
-    PyObject *result = NULL, *main = PyTuple_GET_ITEM(args, indices[0]);
+    PyObject *result = _traverse(policy, main, rest, len);
+    Py_XDECREF(policy.pool);
 
-    if(PyDict_Check(main)) {
-        if(!_validate_dict(args, indices))
-            return NULL;
-
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _ragged_dict(callable, args, kwargs, star, finalizer, indices);
-        Py_LeaveRecursiveCall();
-
-    }
-    else if(PyList_Check(main)) {
-        if(!_validate_list(args, indices))
-            return NULL;
-
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _ragged_list(callable, args, kwargs, star, finalizer, indices);
-        Py_LeaveRecursiveCall();
-
-    }
-    else if(PyTuple_Check(main)) {
-        if(!_validate_tuple(args, indices))
-            return NULL;
-
-        if(Py_EnterRecursiveCall("")) return NULL;
-        result = _ragged_tuple(callable, args, kwargs, star, finalizer, indices);
-        Py_LeaveRecursiveCall();
-    }
-    else {
-        char error[160];
-        PyOS_snprintf(
-            error, 160, "Unsupported type '%s'", Py_TYPE(main)->tp_name);
-
-        PyErr_SetString(PyExc_TypeError, error);
-    }
-
-    if(finalizer == NULL || result == NULL)
-        return result;
-
-    PyObject *output = PyObject_CallWithSingleArg(finalizer, result, NULL);
-    Py_DECREF(result);
-
-    return output;
+    return result;
 }
 
 
 int parse_ragged_args(
-    PyObject *args,
-    PyObject **callable,
-    PyObject **objects)
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject **callable)
 {
-    PyObject *first = PyTuple_GetSlice(args, 0, 1);
-    if (first == NULL)
-        return 0;
-
-    int parsed = PyArg_ParseTuple(first, "O|:ragged", callable);
-    Py_DECREF(first);
-
-    if (!parsed)
+    if(nargs < 1) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "ragged() takes at least 1 argument (%zd given)", nargs);
         return 0;
+    }
 
+    *callable = args[0];
     if(!PyCallable_Check(*callable)) {
         PyErr_SetString(PyExc_TypeError, "The first argument must be a callable.");
         return 0;
     }
 
-    Py_ssize_t len = PyTuple_GET_SIZE(args);
-    *objects = PyTuple_GetSlice(args, 1, len);
-
-    if(PyTuple_GET_SIZE(*objects) < 1) {
+    if(nargs < 2) {
         PyErr_SetString(PyExc_TypeError, "At least one nested object must be provided.");
         return 0;
     }
@@ -361,70 +149,47 @@ int parse_ragged_args(
 
 PyObject* ragged(
     PyObject *self,
-    PyObject *args,
-    PyObject *kwargs)
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
 {
     int star = 1;
 
-    PyObject *callable = NULL, *objects = NULL, *finalizer=NULL;
-    if(!parse_ragged_args(args, &callable, &objects))
+    // the nested objects are borrowed from the fastcall positionals
+    PyObject *callable = NULL, *kwargs = NULL;
+    if(!parse_ragged_args(args, nargs, &callable))
         return NULL;
 
-    if (kwargs) {
-        static const char *kwlist[] = {"_star", "_finalizer", NULL};
+    static const char *kwlist[] = {"_star", "_finalizer", NULL};
 
-        PyObject* own = PyDict_SplitItemStrings(kwargs, kwlist, true);
-        if (own == NULL) {
-            Py_DECREF(objects);
+    // the callables are borrowed from the fastcall keyword values
+    PyObject *own[] = {NULL, NULL};
+    PyObject *finalizer = NULL, *result = NULL;
+    if(!PyArg_ScanKwnames("ragged", args + nargs, kwnames, kwlist, own, &kwargs))
+        goto finally;
 
-            return NULL;
-        }
-
-        PyObject *empty = PyTuple_New(0);
-        if (empty == NULL) {
-            Py_DECREF(objects);
-            Py_DECREF(own);
-
-            return NULL;
-        }
-
-        int parsed = PyArg_ParseTupleAndKeywords(
-            empty, own, "|$pO:ragged", (char**) kwlist, &star, &finalizer);
-
-        Py_DECREF(empty);
-        if (!parsed) {
-            Py_DECREF(objects);
-            Py_DECREF(own);
-
-            return NULL;
-        }
-
-        // while `own` is alive we can be sure the finalizer it alive too
-        if(finalizer != NULL && !PyCallable_Check(finalizer)) {
-            Py_DECREF(objects);
-            Py_DECREF(own);
-
-            PyErr_SetString(PyExc_TypeError, "The finalizer must be a callable.");
-            return NULL;
-        }
+    if(!PyArg_ParseFlag(own[0], &star))
+        goto finally;
 
-        // incref `finalizer` PRIOR to decrefing the temporary subdict `own`
-        Py_XINCREF(finalizer);  // incref unless NULL
-        Py_DECREF(own);
+    finalizer = own[1];
+    if(finalizer != NULL && !PyCallable_Check(finalizer)) {
+        PyErr_SetString(PyExc_TypeError, "The finalizer must be a callable.");
+        goto finally;
     }
 
     // make the call, then decref everything we might own
-    PyObject *result = _ragged(callable, objects, kwargs, star, finalizer);
+    result = _ragged(
+        callable, args[1], args + 2, nargs - 2, kwargs, star, finalizer);
 
-    Py_XDECREF(finalizer);
-    Py_DECREF(objects);
+finally:
+    Py_XDECREF(kwargs);
 
     return result;
 }
 
 const PyMethodDef def_ragged = {
     "ragged",
-    (PyCFunction) ragged,
-    METH_VARARGS | METH_KEYWORDS,
+    (PyCFunction) (void(*)(void)) ragged,
+    METH_FASTCALL | METH_KEYWORDS,
     __doc__,
 };
@@ -0,0 +1,255 @@
+#include <Python.h>
+
+#include <reduce.h>
+#include <validate.h>
+#include <tools.h>
+#include <traverse.h>
+
+
+PyDoc_STRVAR(
+    __doc__,
+    "\n"
+    "reduce(callable, struct, initial=<missing>, *, pairwise=False, _strict=True)\n"
+    "\n"
+    "Fold the leaf data of the nested object with a binary callable.\n"
+    "\n"
+    "Parameters\n"
+    "----------\n"
+    "callable : callable\n"
+    "    A callable of two arguments, the running result and the next leaf.\n"
+    "\n"
+    "struct : nested object\n"
+    "    The nested object, the leaves of which are folded in the same\n"
+    "    depth-first order, as the one of `.flatapply`.\n"
+    "\n"
+    "initial : object, optional\n"
+    "    The value placed before the leaves, which is also the result when\n"
+    "    the nested object has no leaves.\n"
+    "\n"
+    "pairwise : bool, default=False\n"
+    "    Whether to fold the leaves as a balanced binary tree instead of\n"
+    "    left to right. The order of the operands is kept, but the depth of\n"
+    "    the calls is logarithmic in the number of leaves, which reduces\n"
+    "    the rounding errors of floating point sums and shortens the chains\n"
+    "    of dependent operations on arrays. The `initial` value, if given,\n"
+    "    is combined with the folded leaves last.\n"
+    "\n"
+    "_strict : bool, default=True\n"
+    "    Whether to treat the subtypes of built-in containers as leaves.\n"
+    "    See `.apply`.\n"
+    "\n"
+    "Returns\n"
+    "-------\n"
+    "result : object\n"
+    "    The result of the last call of `callable`.\n"
+    "\n"
+    "Details\n"
+    "-------\n"
+    "The leaves are folded as they are met in the traversal, without being\n"
+    "collected into a list first. For `pairwise=False` `reduce` is equivalent\n"
+    "to\n"
+    "\n"
+    ">>> functools.reduce(callable, plyr.flatten(struct)[0], initial)\n"
+    "\n"
+    "and for four leaves `a, b, c, d` and `pairwise=True` it computes\n"
+    "\n"
+    ">>> callable(initial, callable(callable(a, b), callable(c, d)))\n"
+    "\n"
+);
+
+
+// the policy of `_traverse` for `reduce`, which does not rebuild the
+//  structure, and keeps the running result instead
+struct reducer {
+    PyObject *callable;
+    bool strict, pairwise;
+
+    // the number of leaves folded so far
+    Py_ssize_t count;
+
+    // owned refs to the running result of the left-to-right fold, or to the
+    //  partial results of the pairwise fold, see `.fold`
+    std::vector<PyObject *> partial;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], strict);
+
+        return _traverse_enter(frame, row[0], false);
+    }
+
+    PyObject* combine(PyObject *left, PyObject *right)
+    {
+        // call `callable(left, right)`, stealing the refs to both operands
+        PyObject *result = PyObject_CallWithArgs(callable, left, &right, 1, NULL);
+        Py_DECREF(left);
+        Py_DECREF(right);
+
+        return result;
+    }
+
+    int fold(PyObject *value)
+    {
+        // fold the next value in, stealing the ref
+        if(!pairwise) {
+            if(!partial.empty()) {
+                value = combine(partial.back(), value);
+                partial.pop_back();
+                if(value == NULL)
+                    return 0;
+            }
+
+        } else {
+            // The partial results of the pairwise fold are the sums of the
+            //  groups of 2^k values for each bit k set in the number of the
+            //  values folded so far, with the higher bits deeper in the stack:
+            //  the new value is merged with the groups of the same size, like
+            //  in adding one to a binary counter.
+            for(Py_ssize_t bits = count; bits & 1; bits >>= 1) {
+                value = combine(partial.back(), value);
+                partial.pop_back();
+                if(value == NULL)
+                    return 0;
+            }
+        }
+
+        partial.push_back(value);
+        count++;
+
+        return 1;
+    }
+
+    PyObject* collapse()
+    {
+        // merge the partial results from the right end, and return a new ref
+        //  to the result, or NULL with no error set if nothing has been folded
+        if(partial.empty())
+            return NULL;
+
+        PyObject *result = partial.back();
+        partial.pop_back();
+        while(result != NULL && !partial.empty()) {
+            result = combine(partial.back(), result);
+            partial.pop_back();
+        }
+
+        return result;
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        Py_INCREF(row[0]);
+        if(!fold(row[0]))
+            return NULL;
+
+        Py_RETURN_NONE;
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        Py_RETURN_NONE;
+    }
+};
+
+
+static PyObject* _reduce(
+    PyObject *callable,
+    PyObject *main,
+    PyObject *initial,
+    const bool pairwise,
+    const bool strict)
+{
+    reducer policy = {callable, strict, pairwise, 0, {}};
+
+    // the initial value is the leftmost operand of the left-to-right fold,
+    //  and is merged last in the pairwise one
+    if(initial != NULL && !pairwise) {
+        Py_INCREF(initial);
+        policy.partial.push_back(initial);
+    }
+
+    PyObject *result = _traverse(policy, main, NULL, 0);
+    if(result != NULL) {
+        Py_DECREF(result);
+
+        result = policy.collapse();
+        if(result == NULL && PyErr_Occurred()) {
+            // the callable has failed
+
+        } else if(initial != NULL && pairwise) {
+            Py_INCREF(initial);
+            result = result == NULL ? initial : policy.combine(initial, result);
+
+        } else if(result == NULL) {
+            PyErr_SetString(
+                PyExc_TypeError,
+                "reduce() of a structure with no leaves and no initial value");
+
+        }
+    }
+
+    for(PyObject *item : policy.partial)
+        Py_DECREF(item);
+
+    return result;
+}
+
+
+PyObject* reduce(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    int pairwise = 0, strict = 1;
+
+    // `reduce(callable, main, initial=<missing>, /, *, pairwise, _strict)`
+    if(nargs < 2 || nargs > 3) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "reduce() takes 2 or 3 positional arguments (%zd given)", nargs);
+        return NULL;
+    }
+
+    PyObject *callable = args[0], *main = args[1];
+    PyObject *initial = nargs > 2 ? args[2] : NULL;
+
+    static const char *kwlist[] = {"initial", "pairwise", "_strict", NULL};
+
+    PyObject *own[] = {NULL, NULL, NULL};
+    if(!PyArg_ScanKwnames("reduce", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    if(own[0] != NULL) {
+        if(initial != NULL) {
+            PyErr_SetString(
+                PyExc_TypeError, "reduce() got multiple values for 'initial'");
+            return NULL;
+        }
+
+        initial = own[0];
+    }
+
+    if(!PyArg_ParseFlag(own[1], &pairwise) || !PyArg_ParseFlag(own[2], &strict))
+        return NULL;
+
+    if(!PyCallable_Check(callable)) {
+        PyErr_SetString(PyExc_TypeError, "The first argument must be a callable.");
+        return NULL;
+    }
+
+    return _reduce(callable, main, initial, pairwise, strict);
+}
+
+
+const PyMethodDef def_reduce = {
+    "reduce",
+    (PyCFunction) (void(*)(void)) reduce,
+    METH_FASTCALL | METH_KEYWORDS,
+    __doc__,
+};
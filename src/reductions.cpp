@@ -0,0 +1,542 @@
+#include <Python.h>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <reductions.h>
+
+
+// the policy of `_traverse` for the reductions, see `_reduce`
+struct reduction {
+    int op;
+
+    // the number of objects besides the main one
+    Py_ssize_t len;
+
+    // the running result, and the number of elements reduced into it
+    double value;
+    Py_ssize_t numel;
+
+    void update(double partial, Py_ssize_t count)
+    {
+        if(count == 0)
+            return;
+
+        if(op != KERNEL_MAX && op != KERNEL_MAXABS) {
+            value += partial;
+
+        } else if(numel == 0 || (value == value && !(partial <= value))) {
+            // a NaN replaces the running max, and is never replaced
+            value = partial;
+
+        }
+
+        numel += count;
+    }
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        return _ops_enter(frame, row, len, false);
+    }
+
+    PyObject* leaf(PyObject **row);
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1 + len, false, true);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        Py_RETURN_NONE;
+    }
+};
+
+
+static double _ops_reduce_kernel(
+    int dtype,
+    int op,
+    const char *x,
+    Py_ssize_t sx,
+    const char *y,
+    Py_ssize_t sy,
+    Py_ssize_t n)
+{
+    if(dtype == KERNEL_F32)
+        return _kernel_reduce_f32(
+            op, (const float *) x, sx, (const float *) y, sy, n);
+
+    return _kernel_reduce_f64(
+        op, (const double *) x, sx, (const double *) y, sy, n);
+}
+
+
+static void _ops_reduce_rows(
+    reduction &self,
+    int dtype,
+    const Py_buffer &x,
+    const Py_buffer *y,
+    int ndim,
+    Py_ssize_t n,
+    Py_ssize_t sx,
+    Py_ssize_t sy)
+{
+    // walk over the rows of length `n` like an odometer over the indices in
+    //  all dimensions but the last one
+    std::vector<Py_ssize_t> index(ndim > 1 ? ndim - 1 : 0, 0);
+    for(;;) {
+        Py_ssize_t offset_x = 0, offset_y = 0;
+        for(size_t k = 0; k < index.size(); k++) {
+            offset_x += index[k] * x.strides[k];
+            if(y != NULL)
+                offset_y += index[k] * y->strides[k];
+        }
+
+        const char *row_y = y != NULL ? (const char *) y->buf + offset_y : NULL;
+        self.update(_ops_reduce_kernel(
+            dtype, self.op, (const char *) x.buf + offset_x, sx,
+            row_y, sy, n), n);
+
+        int k = (int) index.size() - 1;
+        for(; k >= 0; k--) {
+            if(++index[k] < x.shape[k])
+                break;
+
+            index[k] = 0;
+        }
+
+        if(k < 0)
+            break;
+    }
+}
+
+
+static void _ops_c_strides(Py_buffer &view, Py_ssize_t *strides)
+{
+    // ctypes exports no strides for its arrays, which are C-contiguous
+    if(view.strides != NULL)
+        return;
+
+    Py_ssize_t stride = view.itemsize;
+    for(int k = view.ndim - 1; k >= 0; k--) {
+        strides[k] = stride;
+        stride *= view.shape[k];
+    }
+
+    view.strides = strides;
+}
+
+
+static int _ops_reduce_view(
+    reduction &self,
+    int dtype,
+    Py_buffer x,
+    const Py_buffer *y_)
+{
+    // reduce the buffer(s) of the same shape, unless some stride is not
+    //  a multiple of the itemsize, in which case the leaf is declined
+    Py_ssize_t itemsize = x.itemsize, numel = x.len / itemsize;
+    if(numel == 0)
+        return 1;
+
+    // the copies of the views with the strides filled in
+    Py_ssize_t cx[PyBUF_MAX_NDIM], cy[PyBUF_MAX_NDIM];
+    Py_buffer yy, *y = NULL;
+    _ops_c_strides(x, cx);
+    if(y_ != NULL) {
+        yy = *y_;
+        y = &yy;
+        _ops_c_strides(yy, cy);
+    }
+
+    // C-contiguous buffers are reduced as a single row
+    int ndim = 0;
+    Py_ssize_t n = numel, sx = 1, sy = 1;
+    if(
+        !PyBuffer_IsContiguous(&x, 'C')
+        || (y != NULL && !PyBuffer_IsContiguous(y, 'C'))
+    ) {
+        ndim = x.ndim;
+        for(int k = 0; k < ndim; k++) {
+            if(x.strides[k] % itemsize || (y != NULL && y->strides[k] % itemsize))
+                return 0;
+        }
+
+        n = x.shape[ndim - 1];
+        sx = x.strides[ndim - 1] / itemsize;
+        sy = y != NULL ? y->strides[ndim - 1] / itemsize : sx;
+    }
+
+    // accumulate the rows separately, and add them to the running result
+    reduction local = {self.op, 0, 0., 0};
+    if(numel < KERNEL_NOGIL_SIZE) {
+        _ops_reduce_rows(local, dtype, x, y, ndim, n, sx, sy);
+
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        _ops_reduce_rows(local, dtype, x, y, ndim, n, sx, sy);
+        Py_END_ALLOW_THREADS
+    }
+
+    self.update(local.value, local.numel);
+
+    return 1;
+}
+
+
+static int _ops_reduce_generic(
+    reduction &self,
+    PyObject *x,
+    Py_ssize_t count)
+{
+    // reduce the leaf by its own `.sum()` or `.max()`, e.g. a numpy array of
+    //  ints or bools, much like the arithmetic falls back to the operators
+    if(count == 0)
+        return 1;
+
+    PyObject *leaf;
+    switch(self.op) {
+        case KERNEL_SUMSQ:
+            leaf = PyNumber_Multiply(x, x);
+            break;
+
+        case KERNEL_SUMABS:
+        case KERNEL_MAXABS:
+            leaf = PyNumber_Absolute(x);
+            break;
+
+        default:
+            Py_INCREF(x);
+            leaf = x;
+    }
+
+    if(leaf == NULL)
+        return 0;
+
+    bool max = self.op == KERNEL_MAX || self.op == KERNEL_MAXABS;
+    PyObject *result = PyObject_CallMethod(leaf, max ? "max" : "sum", NULL);
+    Py_DECREF(leaf);
+    if(result == NULL) {
+        if(PyErr_ExceptionMatches(PyExc_AttributeError)) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "'%s' leaves are not supported by the reductions",
+                Py_TYPE(x)->tp_name);
+        }
+
+        return 0;
+    }
+
+    double value = PyFloat_AsDouble(result);
+    Py_DECREF(result);
+    if(value == -1. && PyErr_Occurred())
+        return 0;
+
+    self.update(value, count);
+
+    return 1;
+}
+
+
+static int _ops_reduce_leaf(
+    reduction &self,
+    PyObject *x,
+    PyObject *y)
+{
+    // reduce a float buffer with the kernels, other buffers by their own
+    //  methods, and anything else as a number
+    Py_buffer vx, vy;
+    bool xview = false, yview = false;
+    int dtype = KERNEL_NONE, flags = PyBUF_STRIDES | PyBUF_FORMAT;
+
+    if(PyObject_GetBuffer(x, &vx, flags) == 0) {
+        xview = true;
+        dtype = _kernel_dtype(&vx);
+
+    } else {
+        PyErr_Clear();
+
+    }
+
+    if(dtype != KERNEL_NONE && y != NULL) {
+        if(PyObject_GetBuffer(y, &vy, flags) == 0) {
+            yview = true;
+            if(_kernel_dtype(&vy) != dtype || !_ops_same_shape(vx, vy))
+                dtype = KERNEL_NONE;
+
+        } else {
+            PyErr_Clear();
+            dtype = KERNEL_NONE;
+
+        }
+    }
+
+    int status = 0;
+    if(dtype != KERNEL_NONE)
+        status = _ops_reduce_view(self, dtype, vx, yview ? &vy : NULL);
+
+    Py_ssize_t count = 1;
+    if(xview) {
+        count = vx.len / vx.itemsize;
+        PyBuffer_Release(&vx);
+    }
+
+    if(yview)
+        PyBuffer_Release(&vy);
+
+    if(status)
+        return 1;
+
+    // the product of mismatched leaves is computed by python, e.g. with numpy's
+    //  broadcasting and type promotion, and then summed up
+    if(y != NULL) {
+        PyObject *product = PyNumber_Multiply(x, y);
+        if(product == NULL)
+            return 0;
+
+        self.op = KERNEL_SUM;
+        status = _ops_reduce_leaf(self, product, NULL);
+        self.op = KERNEL_DOT;
+
+        Py_DECREF(product);
+
+        return status;
+    }
+
+    if(xview)
+        return _ops_reduce_generic(self, x, count);
+
+    // the objects, which are not numbers, may still have the methods
+    double value = PyFloat_AsDouble(x);
+    if(value == -1. && PyErr_Occurred()) {
+        if(!PyErr_ExceptionMatches(PyExc_TypeError))
+            return 0;
+
+        PyErr_Clear();
+        return _ops_reduce_generic(self, x, 1);
+    }
+
+    switch(self.op) {
+        case KERNEL_SUMSQ:
+            value *= value;
+            break;
+
+        case KERNEL_SUMABS:
+        case KERNEL_MAXABS:
+            value = std::fabs(value);
+            break;
+    }
+
+    self.update(value, 1);
+
+    return 1;
+}
+
+
+PyObject* reduction::leaf(PyObject **row)
+{
+    // the dot product pairs the leaves, the other reduce them all
+    if(op == KERNEL_DOT) {
+        if(!_ops_reduce_leaf(*this, row[0], row[1]))
+            return NULL;
+
+    } else {
+        for(Py_ssize_t j = 0; j <= len; j++)
+            if(!_ops_reduce_leaf(*this, row[j], NULL))
+                return NULL;
+
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* _reduce(
+    const char *fname,
+    int op,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    double *value)
+{
+    // `fn(*objects)` reduces all leaves of all objects into `value`, and
+    //  returns None, or NULL on error
+    if(nargs < 1) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "%s() takes at least 1 argument (%zd given)", fname, nargs);
+        return NULL;
+    }
+
+    reduction policy = {op, nargs - 1, 0., 0};
+    PyObject *result = _traverse(policy, args[0], args + 1, nargs - 1);
+    if(result == NULL)
+        return NULL;
+
+    if(policy.numel == 0 && op == KERNEL_MAX) {
+        Py_DECREF(result);
+        PyErr_Format(
+            PyExc_ValueError, "%s() of nested objects without elements", fname);
+        return NULL;
+    }
+
+    *value = policy.value;
+
+    return result;
+}
+
+
+static PyObject* _reduce_parse(
+    const char *fname,
+    int op,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    static const char *kwlist[] = {NULL};
+    if(!PyArg_ScanKwnames(fname, args + nargs, kwnames, kwlist, NULL, NULL))
+        return NULL;
+
+    if(op == KERNEL_DOT && nargs != 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "%s() takes exactly 2 positional arguments (%zd given)",
+            fname, nargs);
+        return NULL;
+    }
+
+    double value = 0.;
+    PyObject *result = _reduce(fname, op, args, nargs, &value);
+    if(result == NULL)
+        return NULL;
+
+    Py_DECREF(result);
+
+    return PyFloat_FromDouble(value);
+}
+
+
+PyObject* sum(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _reduce_parse("sum", KERNEL_SUM, args, nargs, kwnames);
+}
+
+
+PyObject* max(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _reduce_parse("max", KERNEL_MAX, args, nargs, kwnames);
+}
+
+
+PyObject* dot(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _reduce_parse("dot", KERNEL_DOT, args, nargs, kwnames);
+}
+
+
+static bool _ops_is_inf(double value)
+{
+    return std::isinf(value) && value > 0.;
+}
+
+
+PyObject* reduce_norm(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    static const char *kwlist[] = {"ord", NULL};
+
+    PyObject *own[] = {NULL};
+    if(!PyArg_ScanKwnames("reduce_norm", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    double ord = 2.;
+    if(own[0] != NULL) {
+        ord = PyFloat_AsDouble(own[0]);
+        if(ord == -1. && PyErr_Occurred())
+            return NULL;
+    }
+
+    int op;
+    if(ord == 2.) {
+        op = KERNEL_SUMSQ;
+
+    } else if(ord == 1.) {
+        op = KERNEL_SUMABS;
+
+    } else if(_ops_is_inf(ord)) {
+        op = KERNEL_MAXABS;
+
+    } else {
+        PyErr_SetString(PyExc_ValueError, "The `ord` must be 1, 2 or inf.");
+        return NULL;
+
+    }
+
+    double value = 0.;
+    PyObject *result = _reduce("reduce_norm", op, args, nargs, &value);
+    if(result == NULL)
+        return NULL;
+
+    Py_DECREF(result);
+
+    return PyFloat_FromDouble(op == KERNEL_SUMSQ ? std::sqrt(value) : value);
+}
+
+
+const PyMethodDef def_sum = {
+    "sum",
+    (PyCFunction) (void(*)(void)) sum,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "sum(*objects)\n"
+        "\n"
+        "The sum of all elements in the leaves of all nested objects.\n"
+    ),
+};
+
+
+const PyMethodDef def_max = {
+    "max",
+    (PyCFunction) (void(*)(void)) max,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "max(*objects)\n"
+        "\n"
+        "The largest element in the leaves of all nested objects, or NaN\n"
+        "if any element is NaN.\n"
+    ),
+};
+
+
+const PyMethodDef def_dot = {
+    "dot",
+    (PyCFunction) (void(*)(void)) dot,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "dot(x, y)\n"
+        "\n"
+        "The sum of the elementwise products of the leaves of `x` and `y`,\n"
+        "i.e. the dot product of the flattened nested objects.\n"
+    ),
+};
+
+
+const PyMethodDef def_reduce_norm = {
+    "reduce_norm",
+    (PyCFunction) (void(*)(void)) reduce_norm,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "reduce_norm(*objects, ord=2)\n"
+        "\n"
+        "The global `ord`-norm (1, 2 or inf) of the leaves of all nested\n"
+        "objects, e.g. `sqrt(sum(||g||^2))` for gradient clipping.\n"
+    ),
+};
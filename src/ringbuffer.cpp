@@ -0,0 +1,741 @@
+#include <Python.h>
+#include <cstring>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <populate.h>
+#include <ringbuffer.h>
+
+
+// a fixed-capacity store of nested records, which keeps the leaves of the
+//  records in a C-contiguous column per leaf of the template
+typedef struct {
+    PyObject_HEAD
+    // the structure of the template with None in place of its leaves
+    PyObject *skeleton;
+    int strict;
+
+    // the number of columns, and the owned refs to the columns and to their
+    //  memoryviews
+    Py_ssize_t numel;
+    PyObject **columns, **views;
+
+    // the owned refs to the 0-d memoryviews of a single item of the scalar
+    //  columns, or NULL, which convert the leaves that are not buffers
+    PyObject **stages;
+
+    // the number of rows, the number of written rows, and the next row
+    Py_ssize_t capacity, size, head;
+} RingBufferObject;
+
+
+static PyObject* _ring_column(PyObject *leaf, Py_ssize_t capacity)
+{
+    // a new zeroed column of `capacity` rows with the format and the shape
+    //  of the leaf, the python numbers are stored like in numpy arrays
+    Py_buffer view;
+    bool acquired = PyObject_GetBuffer(leaf, &view, PyBUF_RECORDS_RO) == 0;
+    if(!acquired) {
+        PyErr_Clear();
+
+        memset(&view, 0, sizeof(view));
+        if(PyBool_Check(leaf)) {
+            view.format = (char *) "?";
+            view.itemsize = 1;
+
+        } else if(PyLong_Check(leaf)) {
+            view.format = (char *) "q";
+            view.itemsize = 8;
+
+        } else if(PyFloat_Check(leaf)) {
+            view.format = (char *) "d";
+            view.itemsize = 8;
+
+        } else {
+            PyErr_Format(
+                PyExc_TypeError,
+                "The leaves of the template must be buffers or numbers, "
+                "not '%s'", Py_TYPE(leaf)->tp_name);
+            return NULL;
+
+        }
+
+        view.len = view.itemsize;
+    }
+
+    PyObject *column = NULL;
+    if(view.len > 0 && capacity > PY_SSIZE_T_MAX / view.len) {
+        PyErr_NoMemory();
+
+    } else {
+        column = _ops_buffer(view, capacity, capacity * view.len, false);
+        if(column != NULL)
+            memset(((OpsBufferObject *) column)->data, 0, capacity * view.len);
+
+    }
+
+    if(acquired)
+        PyBuffer_Release(&view);
+
+    return column;
+}
+
+
+static PyObject* _ring_stage(const OpsBufferObject *column)
+{
+    // a 0-d memoryview of a new item with the format of the scalar column
+    OpsBufferObject *item = _ops_buffer_new(
+        column->format, column->itemsize, 0, column->itemsize, NULL);
+    if(item == NULL)
+        return NULL;
+
+    memset(item->data, 0, item->len);
+    PyObject *stage = PyMemoryView_FromObject((PyObject *) item);
+    Py_DECREF(item);
+
+    return stage;
+}
+
+
+// the policy of `_traverse` for the template of `RingBuffer`
+struct columnizer {
+    bool strict;
+    Py_ssize_t capacity;
+
+    // owned refs to the columns of the leaves in depth-first order
+    std::vector<PyObject *> columns;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], strict);
+
+        return _traverse_enter(frame, row[0]);
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        // the leaves of the skeleton are None
+        PyObject *column = _ring_column(row[0], capacity);
+        if(column == NULL)
+            return NULL;
+
+        columns.push_back(column);
+
+        Py_RETURN_NONE;
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+// the policy of `_traverse` for `RingBuffer.push` and `.extend`, which only
+//  checks the leaves and converts the numbers, so that nothing is written
+//  unless all of them fit
+struct ringwriter {
+    RingBufferObject *self;
+    bool batch;
+
+    // the index of the column of the next leaf, and the number of rows in
+    //  the batch, negative until the first leaf
+    Py_ssize_t pos, count;
+
+    // the acquired views of the leaves and their columns
+    std::vector<Py_buffer> views;
+    std::vector<Py_ssize_t> targets;
+
+    // the columns of the leaves that are not buffers, which have been
+    //  converted into the stages of the columns
+    std::vector<Py_ssize_t> fallback;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], self->strict);
+        if(!_traverse_validate(frame.kind, row, 1))
+            return 0;
+
+        return _traverse_enter(frame, row[0], false);
+    }
+
+    int matches(const OpsBufferObject *column, const Py_buffer &value);
+
+    PyObject* leaf(PyObject **row);
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 2, false, true);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        Py_RETURN_NONE;
+    }
+
+    void release()
+    {
+        for(Py_buffer &view : views)
+            PyBuffer_Release(&view);
+
+        views.clear();
+    }
+};
+
+
+int ringwriter::matches(const OpsBufferObject *column, const Py_buffer &value)
+{
+    // check if the value is a C-contiguous buffer with the format of the
+    //  column and the shape of its row, or of its rows for a batch
+    int ndim = batch ? column->ndim : column->ndim - 1;
+    if(
+        value.itemsize != column->itemsize
+        || !_ops_same_format(_ops_format(value), column->format)
+        || !PyBuffer_IsContiguous(&value, 'C') || value.ndim != ndim
+    )
+        return 0;
+
+    for(int k = batch ? 1 : 0; k < ndim; k++)
+        if(value.shape[k] != column->shape[batch ? k : k + 1])
+            return 0;
+
+    return 1;
+}
+
+
+PyObject* ringwriter::leaf(PyObject **row)
+{
+    Py_ssize_t j = pos++;
+    OpsBufferObject *column = (OpsBufferObject *) self->columns[j];
+
+    Py_buffer value;
+    if(PyObject_GetBuffer(row[1], &value, PyBUF_RECORDS_RO) == 0) {
+        if(matches(column, value)) {
+            if(batch && count >= 0 && value.shape[0] != count) {
+                PyErr_Format(
+                    PyExc_ValueError,
+                    "The leaves must have the same number of rows (%zd != %zd)",
+                    value.shape[0], count);
+
+                PyBuffer_Release(&value);
+                return NULL;
+            }
+
+            if(batch)
+                count = value.shape[0];
+
+            views.push_back(value);
+            targets.push_back(j);
+
+            Py_RETURN_NONE;
+        }
+
+        PyBuffer_Release(&value);
+
+    } else {
+        PyErr_Clear();
+
+    }
+
+    // the scalar columns also take the numbers, which are converted by
+    //  the memoryview, e.g. python floats or the scalars of another dtype
+    if(!batch && column->ndim == 1) {
+        if(PyObject_SetItem(self->stages[j], Py_Ellipsis, row[1]) < 0)
+            return NULL;
+
+        fallback.push_back(j);
+
+        Py_RETURN_NONE;
+    }
+
+    PyErr_Format(
+        PyExc_TypeError,
+        "The leaf '%s' is not a C-contiguous buffer of the format '%s' and "
+        "of the shape of the %s of the column",
+        Py_TYPE(row[1])->tp_name, column->format, batch ? "rows" : "row");
+
+    return NULL;
+}
+
+
+static PyObject* _ring_cleared()
+{
+    PyErr_SetString(PyExc_ValueError, "The ring buffer has been cleared.");
+    return NULL;
+}
+
+
+static PyObject* _ring_write(
+    RingBufferObject *self,
+    PyObject *record,
+    const bool batch)
+{
+    if(self->skeleton == NULL)
+        return _ring_cleared();
+
+    ringwriter policy = {self, batch, 0, -1, {}, {}, {}};
+
+    PyObject *result = _traverse(policy, self->skeleton, &record, 1);
+    if(result == NULL) {
+        policy.release();
+        return NULL;
+    }
+
+    Py_DECREF(result);
+
+    // only the last `capacity` rows of a batch are kept
+    Py_ssize_t capacity = self->capacity;
+    Py_ssize_t count = batch ? (policy.count < 0 ? 0 : policy.count) : 1;
+    Py_ssize_t rows = count < capacity ? count : capacity;
+    Py_ssize_t start = (self->head + (count - rows) % capacity) % capacity;
+
+    // the rows are written in at most two pieces, split at the end
+    std::vector<char *> dst = {};
+    std::vector<const char *> src = {};
+    std::vector<Py_ssize_t> len = {};
+
+    Py_ssize_t numel = 0, first = capacity - start < rows ? capacity - start : rows;
+    for(size_t k = 0; k < policy.views.size(); k++) {
+        OpsBufferObject *column = (OpsBufferObject *) self->columns[policy.targets[k]];
+        Py_ssize_t inner = column->len / capacity;
+        const char *data = (const char *) policy.views[k].buf + (count - rows) * inner;
+
+        dst.push_back(column->data + start * inner);
+        src.push_back(data);
+        len.push_back(first * inner);
+        if(first < rows) {
+            dst.push_back(column->data);
+            src.push_back(data + first * inner);
+            len.push_back((rows - first) * inner);
+        }
+
+        numel += rows * inner / column->itemsize;
+    }
+
+    if(numel < KERNEL_NOGIL_SIZE) {
+        _kernel_gather(dst.data(), src.data(), len.data(), dst.size(), 1);
+
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        _kernel_gather(dst.data(), src.data(), len.data(), dst.size(), 0);
+        Py_END_ALLOW_THREADS
+    }
+
+    for(Py_ssize_t j : policy.fallback) {
+        OpsBufferObject *column = (OpsBufferObject *) self->columns[j];
+        memcpy(
+            column->data + start * column->itemsize,
+            PyMemoryView_GET_BUFFER(self->stages[j])->buf, column->itemsize);
+    }
+
+    policy.release();
+
+    self->head = (self->head + count) % capacity;
+    self->size = self->size + count < capacity ? self->size + count : capacity;
+
+    Py_RETURN_NONE;
+}
+
+
+static PyObject* _ring_rebuild(RingBufferObject *self, PyObject *leaves)
+{
+    // put the leaves into the structure of the template, stealing the ref
+    if(leaves == NULL)
+        return NULL;
+
+    if(self->skeleton == NULL) {
+        Py_DECREF(leaves);
+        return _ring_cleared();
+    }
+
+    PyObject *result = _populate_source(
+        leaves, self->skeleton, NULL, self->strict, NULL);
+    Py_DECREF(leaves);
+
+    return result;
+}
+
+
+static PyObject* RingBuffer_new(
+    PyTypeObject *type,
+    PyObject *args,
+    PyObject *kwargs)
+{
+    PyObject *main = NULL;
+    Py_ssize_t capacity = 0;
+    int strict = 1;
+
+    static const char *kwlist[] = {"template", "capacity", "_strict", NULL};
+    if(!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "On|$p:RingBuffer", (char**) kwlist,
+        &main, &capacity, &strict
+    ))
+        return NULL;
+
+    if(capacity < 1) {
+        PyErr_SetString(PyExc_ValueError, "The capacity must be positive.");
+        return NULL;
+    }
+
+    columnizer policy = {(bool) strict, capacity, {}};
+
+    PyObject *skeleton = _traverse(policy, main, NULL, 0);
+    RingBufferObject *self = NULL;
+    Py_ssize_t numel = policy.columns.size();
+    if(skeleton == NULL)
+        goto finally;
+
+    self = (RingBufferObject *) type->tp_alloc(type, 0);
+    if(self == NULL)
+        goto finally;
+
+    self->strict = strict;
+    self->capacity = capacity;
+    self->size = self->head = 0;
+    self->columns = PyMem_New(PyObject *, numel > 0 ? numel : 1);
+    self->views = PyMem_New(PyObject *, numel > 0 ? numel : 1);
+    self->stages = PyMem_New(PyObject *, numel > 0 ? numel : 1);
+    if(self->columns == NULL || self->views == NULL || self->stages == NULL) {
+        PyErr_NoMemory();
+        Py_CLEAR(self);
+        goto finally;
+    }
+
+    // the columns are moved into the ring buffer
+    for(Py_ssize_t j = 0; j < numel; j++) {
+        OpsBufferObject *column = (OpsBufferObject *) policy.columns[j];
+        PyObject *view = PyMemoryView_FromObject(policy.columns[j]);
+        PyObject *stage = NULL;
+        if(view != NULL && column->ndim == 1)
+            stage = _ring_stage(column);
+
+        if(view == NULL || (column->ndim == 1 && stage == NULL)) {
+            Py_XDECREF(view);
+            Py_CLEAR(self);
+            goto finally;
+        }
+
+        self->columns[j] = policy.columns[j];
+        self->views[j] = view;
+        self->stages[j] = stage;
+        self->numel = j + 1;
+        policy.columns[j] = NULL;
+    }
+
+    self->skeleton = skeleton;
+    skeleton = NULL;
+
+finally:
+    for(PyObject *column : policy.columns)
+        Py_XDECREF(column);
+
+    Py_XDECREF(skeleton);
+
+    return (PyObject *) self;
+}
+
+
+static int RingBuffer_traverse(RingBufferObject *self, visitproc visit, void *arg)
+{
+    // the skeleton may hold the ring buffer in the keys of its dicts
+    Py_VISIT(self->skeleton);
+    for(Py_ssize_t j = 0; j < self->numel; j++) {
+        Py_VISIT(self->columns[j]);
+        Py_VISIT(self->views[j]);
+        Py_VISIT(self->stages[j]);
+    }
+
+    return 0;
+}
+
+
+static int RingBuffer_clear(RingBufferObject *self)
+{
+    // a cleared ring buffer has no leaves and refuses any access
+    Py_CLEAR(self->skeleton);
+    for(Py_ssize_t j = 0; j < self->numel; j++) {
+        Py_CLEAR(self->columns[j]);
+        Py_CLEAR(self->views[j]);
+        Py_CLEAR(self->stages[j]);
+    }
+
+    self->numel = 0;
+    self->size = self->head = 0;
+
+    return 0;
+}
+
+
+static void RingBuffer_dealloc(RingBufferObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    RingBuffer_clear(self);
+
+    PyMem_Free(self->columns);
+    PyMem_Free(self->views);
+    PyMem_Free(self->stages);
+
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+
+static PyObject* RingBuffer_repr(RingBufferObject *self)
+{
+    return PyUnicode_FromFormat(
+        "RingBuffer(capacity=%zd, size=%zd, num_leaves=%zd)",
+        self->capacity, self->size, self->numel);
+}
+
+
+static Py_ssize_t RingBuffer_len(RingBufferObject *self)
+{
+    return self->size;
+}
+
+
+static PyObject* RingBuffer_push(RingBufferObject *self, PyObject *record)
+{
+    return _ring_write(self, record, false);
+}
+
+
+static PyObject* RingBuffer_extend(RingBufferObject *self, PyObject *batch)
+{
+    return _ring_write(self, batch, true);
+}
+
+
+static PyObject* RingBuffer_sample(RingBufferObject *self, PyObject *index)
+{
+    std::vector<Py_ssize_t> indices = {};
+    if(!_ops_indices(index, indices))
+        return NULL;
+
+    if(!_ops_check_bounds(indices, 0, self->size))
+        return NULL;
+
+    // the indices are relative to the oldest row, so that the negative ones
+    //  are the latest records, and are turned into the slots of the storage
+    Py_ssize_t oldest = (self->head - self->size + self->capacity) % self->capacity;
+    for(Py_ssize_t &pos : indices)
+        pos = (oldest + (pos < 0 ? pos + self->size : pos)) % self->capacity;
+
+    Py_ssize_t count = indices.size();
+    PyObject *leaves = PyList_New(self->numel);
+    if(leaves == NULL)
+        return NULL;
+
+    // the rows are gathered into new buffers after all of them are made
+    rowcopies copies = {{}, {}, 0};
+    for(Py_ssize_t j = 0; j < self->numel; j++) {
+        OpsBufferObject *column = (OpsBufferObject *) self->columns[j];
+        Py_ssize_t inner = column->len / self->capacity;
+
+        Py_buffer view;
+        if(PyObject_GetBuffer((PyObject *) column, &view, PyBUF_RECORDS) < 0) {
+            Py_DECREF(leaves);
+            return NULL;
+        }
+
+        PyObject *data = _ops_buffer(view, count, count * inner, true);
+        PyBuffer_Release(&view);
+        if(data == NULL) {
+            Py_DECREF(leaves);
+            return NULL;
+        }
+
+        // the memoryview keeps the new buffer alive
+        char *dst = ((OpsBufferObject *) data)->data;
+        PyObject *leaf = PyMemoryView_FromObject(data);
+        Py_DECREF(data);
+        if(leaf == NULL) {
+            Py_DECREF(leaves);
+            return NULL;
+        }
+
+        PyList_SET_ITEM(leaves, j, leaf);
+        copies.jobs.push_back({dst, column->data, 1, self->capacity, inner});
+        copies.numel += count * inner / column->itemsize;
+    }
+
+    if(copies.numel < KERNEL_NOGIL_SIZE) {
+        copies.run(indices, 1);
+
+    } else {
+        Py_BEGIN_ALLOW_THREADS
+        copies.run(indices, 0);
+        Py_END_ALLOW_THREADS
+    }
+
+    return _ring_rebuild(self, leaves);
+}
+
+
+static PyObject* RingBuffer_get_capacity(RingBufferObject *self, void *closure)
+{
+    return PyLong_FromSsize_t(self->capacity);
+}
+
+
+static PyObject* RingBuffer_get_head(RingBufferObject *self, void *closure)
+{
+    return PyLong_FromSsize_t(self->head);
+}
+
+
+static PyObject* RingBuffer_get_columns(RingBufferObject *self, void *closure)
+{
+    PyObject *leaves = PyList_New(self->numel);
+    if(leaves == NULL)
+        return NULL;
+
+    for(Py_ssize_t j = 0; j < self->numel; j++) {
+        Py_INCREF(self->views[j]);
+        PyList_SET_ITEM(leaves, j, self->views[j]);
+    }
+
+    return _ring_rebuild(self, leaves);
+}
+
+
+static PySequenceMethods RingBuffer_as_sequence = {
+    (lenfunc) RingBuffer_len,       /* sq_length */
+};
+
+
+static PyMethodDef RingBuffer_methods[] = {
+    {
+        "push",
+        (PyCFunction) RingBuffer_push,
+        METH_O,
+        PyDoc_STR(
+            "push(record)\n"
+            "\n"
+            "Write the nested record with the structure of the template into\n"
+            "the next row, overwriting the oldest one when full. The leaves\n"
+            "must be C-contiguous buffers with the formats and the shapes of\n"
+            "the leaves of the template, or numbers for the scalar leaves."
+        ),
+    }, {
+        "extend",
+        (PyCFunction) RingBuffer_extend,
+        METH_O,
+        PyDoc_STR(
+            "extend(batch)\n"
+            "\n"
+            "Write the rows of the nested batch, the leaves of which are the\n"
+            "C-contiguous buffers of the leaves of the template stacked along\n"
+            "the first dim, in order. Only the last `capacity` rows are kept."
+        ),
+    }, {
+        "sample",
+        (PyCFunction) RingBuffer_sample,
+        METH_O,
+        PyDoc_STR(
+            "sample(indices)\n"
+            "\n"
+            "Gather the rows at `indices`, a 1d buffer or a sequence of ints\n"
+            "in [-len, len), into a nested object with the structure of the\n"
+            "template and memoryviews of new buffers in the leaves. The rows\n"
+            "are in the order of writing, from the oldest record at 0 to the\n"
+            "latest one at -1. Large gathers are copied by several threads\n"
+            "and without the GIL."
+        ),
+    }, {
+        NULL,
+        NULL,
+        0,
+        NULL,
+    }
+};
+
+
+static PyGetSetDef RingBuffer_getset[] = {
+    {
+        (char*) "head",
+        (getter) RingBuffer_get_head,
+        NULL,
+        (char*) "The slot of the storage for the next record.",
+        NULL,
+    }, {
+        (char*) "capacity",
+        (getter) RingBuffer_get_capacity,
+        NULL,
+        (char*) "The maximal number of records.",
+        NULL,
+    }, {
+        (char*) "columns",
+        (getter) RingBuffer_get_columns,
+        NULL,
+        (char*) "The writable memoryviews of the columns of all rows in the"
+                " structure of the template. The rows are the slots of the"
+                " storage, with the next record written into `head`.",
+        NULL,
+    }, {
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+    }
+};
+
+
+PyTypeObject RingBuffer_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "plyr.RingBuffer",              /* tp_name */
+    sizeof(RingBufferObject),       /* tp_basicsize */
+    0,                              /* tp_itemsize */
+    (destructor) RingBuffer_dealloc,  /* tp_dealloc */
+    0,                              /* tp_vectorcall_offset */
+    0,                              /* tp_getattr */
+    0,                              /* tp_setattr */
+    0,                              /* tp_as_async */
+    (reprfunc) RingBuffer_repr,     /* tp_repr */
+    0,                              /* tp_as_number */
+    &RingBuffer_as_sequence,        /* tp_as_sequence */
+    0,                              /* tp_as_mapping */
+    0,                              /* tp_hash */
+    0,                              /* tp_call */
+    0,                              /* tp_str */
+    0,                              /* tp_getattro */
+    0,                              /* tp_setattro */
+    0,                              /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,  /* tp_flags */
+    PyDoc_STR(
+        "RingBuffer(template, capacity, *, _strict=True)\n"
+        "\n"
+        "A fixed-capacity store of nested records, e.g. the transitions of\n"
+        "a replay buffer, with the structure of the template. Each leaf of\n"
+        "the template, a buffer or a python number, gets a C-contiguous\n"
+        "column of `capacity` rows of its format and shape. The records are\n"
+        "written by `.push` and `.extend` in a circle, and are read by\n"
+        "`.sample`. The access is not synchronized between threads."
+    ),                              /* tp_doc */
+    (traverseproc) RingBuffer_traverse,  /* tp_traverse */
+    (inquiry) RingBuffer_clear,     /* tp_clear */
+    0,                              /* tp_richcompare */
+    0,                              /* tp_weaklistoffset */
+    0,                              /* tp_iter */
+    0,                              /* tp_iternext */
+    RingBuffer_methods,             /* tp_methods */
+    0,                              /* tp_members */
+    RingBuffer_getset,              /* tp_getset */
+    0,                              /* tp_base */
+    0,                              /* tp_dict */
+    0,                              /* tp_descr_get */
+    0,                              /* tp_descr_set */
+    0,                              /* tp_dictoffset */
+    0,                              /* tp_init */
+    0,                              /* tp_alloc */
+    (newfunc) RingBuffer_new,       /* tp_new */
+};
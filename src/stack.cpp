@@ -0,0 +1,227 @@
+#include <Python.h>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <stack.h>
+
+
+// the policy of `_traverse` for `stack` and `concatenate`
+struct stacker {
+    bool concat;
+    PyObject *committer;
+
+    // the number of objects in a row
+    Py_ssize_t width;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        return _ops_enter(frame, row, width - 1, true);
+    }
+
+    PyObject* leaf(PyObject **row);
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, width, false, true);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+static int _ops_check_stack(
+    const Py_buffer &view,
+    const Py_buffer &main,
+    const bool concat)
+{
+    // the buffers are stacked if they have the same format and shape, and
+    //  concatenated if they have the same format and shape but the first dim
+    if(
+        view.itemsize != main.itemsize
+        || !_ops_same_format(_ops_format(view), _ops_format(main))
+    ) {
+        PyErr_Format(
+            PyExc_TypeError, "The leaves have different formats ('%s', '%s')",
+            main.format == NULL ? "B" : main.format,
+            view.format == NULL ? "B" : view.format);
+        return 0;
+    }
+
+    if(concat && view.ndim == 0) {
+        PyErr_SetString(
+            PyExc_ValueError, "Zero-dimensional leaves cannot be concatenated");
+        return 0;
+    }
+
+    bool same = view.ndim == main.ndim;
+    for(int k = concat ? 1 : 0; same && k < view.ndim; k++)
+        same = view.shape[k] == main.shape[k];
+
+    if(!same) {
+        PyErr_SetString(
+            PyExc_ValueError, concat
+                ? "The leaves must have the same shape except in the first dim"
+                : "The leaves must have the same shape");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+PyObject* stacker::leaf(PyObject **row)
+{
+    // the views of the leaves, and the copies of the contiguous ones, which
+    //  are made by `_kernel_gather`
+    std::vector<Py_buffer> views(width);
+    std::vector<char *> dst_(width, NULL);
+    std::vector<const char *> src(width, NULL);
+    std::vector<Py_ssize_t> len(width, 0);
+
+    Py_ssize_t acquired = 0, total = 0, first = 0;
+    PyObject *data = NULL, *result = NULL;
+    for(; acquired < width; acquired++) {
+        Py_buffer &view = views[acquired];
+        if(PyObject_GetBuffer(row[acquired], &view, PyBUF_RECORDS_RO) < 0)
+            goto finally;
+
+        if(!_ops_check_stack(view, views[0], concat)) {
+            PyBuffer_Release(&view);
+            goto finally;
+        }
+
+        total += view.len;
+        first += concat ? view.shape[0] : 1;
+    }
+
+    data = _ops_buffer(views[0], first, total, concat);
+    if(data == NULL)
+        goto finally;
+
+    {
+        // strided buffers are copied right away with the GIL held, since
+        //  `PyBuffer_ToContiguous` may allocate
+        char *dst = ((OpsBufferObject *) data)->data;
+        for(Py_ssize_t j = 0, offset = 0; j < width; offset += views[j++].len) {
+            if(PyBuffer_IsContiguous(&views[j], 'C')) {
+                dst_[j] = dst + offset;
+                src[j] = (const char *) views[j].buf;
+                len[j] = views[j].len;
+
+            } else if(
+                PyBuffer_ToContiguous(dst + offset, &views[j], views[j].len, 'C') < 0
+            ) {
+                goto finally;
+
+            }
+        }
+
+        // the contiguous buffers are copied by all threads without the GIL
+        if(total / views[0].itemsize < KERNEL_NOGIL_SIZE) {
+            _kernel_gather(dst_.data(), src.data(), len.data(), width, 1);
+
+        } else {
+            Py_BEGIN_ALLOW_THREADS
+            _kernel_gather(dst_.data(), src.data(), len.data(), width, 0);
+            Py_END_ALLOW_THREADS
+        }
+    }
+
+    result = PyMemoryView_FromObject(data);
+
+finally:
+    for(Py_ssize_t j = 0; j < acquired; j++)
+        PyBuffer_Release(&views[j]);
+
+    Py_XDECREF(data);
+
+    // the committer is only called on the complete leaf data
+    if(committer == NULL || result == NULL)
+        return result;
+
+    Py_SETREF(result, PyObject_CallWithSingleArg(committer, result, NULL));
+
+    return result;
+}
+
+
+static PyObject* _stack_parse(
+    const char *fname,
+    const bool concat,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    // `fn(*objects, committer=None)`
+    if(nargs < 1) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "%s() takes at least 1 argument (%zd given)", fname, nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"committer", NULL};
+
+    PyObject *own[] = {NULL};
+    if(!PyArg_ScanKwnames(fname, args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    PyObject *committer = own[0] == Py_None ? NULL : own[0];
+    if(committer != NULL && !PyCallable_Check(committer)) {
+        PyErr_SetString(PyExc_TypeError, "The committer must be a callable.");
+        return NULL;
+    }
+
+    stacker policy = {concat, committer, nargs};
+
+    return _traverse(policy, args[0], args + 1, nargs - 1);
+}
+
+
+PyObject* stack(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _stack_parse("stack", false, args, nargs, kwnames);
+}
+
+
+PyObject* concatenate(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    return _stack_parse("concatenate", true, args, nargs, kwnames);
+}
+
+
+const PyMethodDef def_stack = {
+    "stack",
+    (PyCFunction) (void(*)(void)) stack,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "stack(*objects, committer=None)\n"
+        "\n"
+        "Stack the buffers in the leaves of the nested objects along a new\n"
+        "first dim. The leaves of each position must have the same format\n"
+        "and shape. Each result is a memoryview of a new C-contiguous buffer,\n"
+        "or the value of `committer` on it, e.g. `np.asarray`.\n"
+    ),
+};
+
+
+const PyMethodDef def_concatenate = {
+    "concatenate",
+    (PyCFunction) (void(*)(void)) concatenate,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "concatenate(*objects, committer=None)\n"
+        "\n"
+        "Concatenate the buffers in the leaves of the nested objects along\n"
+        "their first dim, in which only their shapes may differ. See `stack`.\n"
+    ),
+};
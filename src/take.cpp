@@ -0,0 +1,606 @@
+#include <Python.h>
+#include <vector>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <kernels.h>
+#include <buffers.h>
+#include <take.h>
+
+
+static bool _ops_axis(
+    const Py_buffer &view,
+    int axis,
+    Py_ssize_t &outer,
+    Py_ssize_t &dim,
+    Py_ssize_t &inner)
+{
+    // split the C-contiguous buffer into `outer` blocks of `dim` rows of
+    //  `inner` bytes along the axis, if it has one
+    if(axis < 0 || axis >= view.ndim)
+        return false;
+
+    outer = 1;
+    for(int k = 0; k < axis; k++)
+        outer *= view.shape[k];
+
+    dim = view.shape[axis];
+    inner = view.itemsize;
+    for(int k = axis + 1; k < view.ndim; k++)
+        inner *= view.shape[k];
+
+    return true;
+}
+
+
+static int _ops_parse_axis(PyObject *obj, int &axis)
+{
+    // the optional non-negative axis of `take` and `put`
+    if(obj == NULL)
+        return 1;
+
+    Py_ssize_t value = PyNumber_AsSsize_t(obj, PyExc_OverflowError);
+    if(value == -1 && PyErr_Occurred())
+        return 0;
+
+    if(value < 0 || value >= PyBUF_MAX_NDIM) {
+        PyErr_Format(
+            PyExc_ValueError,
+            "The axis must be in [0, %d), not %zd.", PyBUF_MAX_NDIM, value);
+        return 0;
+    }
+
+    axis = (int) value;
+
+    return 1;
+}
+
+
+static PyObject* _ops_key(PyObject *index, int axis)
+{
+    // a new ref to the key of `getitem` and `setitem` for the other leaves,
+    //  which is `index`, or `(:, ..., :, index)` if the axis is not the first
+    if(axis == 0) {
+        Py_INCREF(index);
+        return index;
+    }
+
+    PyObject *key = PyTuple_New(axis + 1);
+    if(key == NULL)
+        return NULL;
+
+    for(int k = 0; k < axis; k++) {
+        PyObject *all = PySlice_New(NULL, NULL, NULL);
+        if(all == NULL) {
+            Py_DECREF(key);
+            return NULL;
+        }
+
+        PyTuple_SET_ITEM(key, k, all);
+    }
+
+    Py_INCREF(index);
+    PyTuple_SET_ITEM(key, axis, index);
+
+    return key;
+}
+
+
+static int _ops_take_strided(
+    const Py_buffer &view,
+    char *dst,
+    const std::vector<Py_ssize_t> &indices,
+    int axis)
+{
+    // gather the rows of a strided buffer one sub-array at a time: each block
+    //  of the leading dims and each index pick a sub-array of the trailing
+    //  dims, which is copied in C order
+    Py_ssize_t outer = 1, inner = view.itemsize, dim = view.shape[axis];
+    for(int k = 0; k < axis; k++)
+        outer *= view.shape[k];
+
+    for(int k = axis + 1; k < view.ndim; k++)
+        inner *= view.shape[k];
+
+    Py_buffer row = view;
+    row.len = inner;
+    row.ndim = view.ndim - axis - 1;
+    row.shape = view.shape + axis + 1;
+    row.strides = view.strides + axis + 1;
+    row.suboffsets = NULL;
+
+    for(Py_ssize_t p = 0; p < outer; p++) {
+        const char *base = (const char *) view.buf;
+        for(Py_ssize_t k = axis - 1, q = p; k >= 0; k--) {
+            base += (q % view.shape[k]) * view.strides[k];
+            q /= view.shape[k];
+        }
+
+        for(Py_ssize_t pos : indices) {
+            pos = pos < 0 ? pos + dim : pos;
+            row.buf = (void *) (base + pos * view.strides[axis]);
+            if(PyBuffer_ToContiguous(dst, &row, inner, 'C') < 0)
+                return 0;
+
+            dst += inner;
+        }
+    }
+
+    return 1;
+}
+
+
+// the policy of `_traverse` for `take`
+struct taker {
+    int axis;
+    PyObject *key;
+    const std::vector<Py_ssize_t> *indices;
+    PyObject *committer;
+
+    // the rows of the buffers to be copied into the new leaves
+    rowcopies copies;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], true);
+
+        return _traverse_enter(frame, row[0]);
+    }
+
+    PyObject* leaf(PyObject **row);
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+PyObject* taker::leaf(PyObject **row)
+{
+    // the buffers with the axis get new C-contiguous buffers with the rows,
+    //  and the other leaves are indexed by `key` right away
+    Py_buffer view;
+    if(PyObject_GetBuffer(row[0], &view, PyBUF_RECORDS_RO) < 0) {
+        PyErr_Clear();
+        return PyObject_GetItem(row[0], key);
+    }
+
+    Py_ssize_t outer, dim, inner, count = indices->size();
+    if(!_ops_axis(view, axis, outer, dim, inner)) {
+        PyBuffer_Release(&view);
+        return PyObject_GetItem(row[0], key);
+    }
+
+    if(!_ops_check_bounds(*indices, axis, dim)) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    // the result has the shape of the leaf with `count` rows along the axis
+    Py_ssize_t size = outer * count * inner;
+    PyObject *data = _ops_buffer(view, count, size, true, axis);
+    if(data == NULL) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    char *dst = ((OpsBufferObject *) data)->data;
+    const char *src = (const char *) view.buf;
+    if(!PyBuffer_IsContiguous(&view, 'C')) {
+        // the strided rows are copied right away with the GIL held, since
+        //  `PyBuffer_ToContiguous` may allocate
+        int status = _ops_take_strided(view, dst, *indices, axis);
+        PyBuffer_Release(&view);
+        if(!status) {
+            Py_DECREF(data);
+            return NULL;
+        }
+
+    } else if(committer != NULL) {
+        // the committer is only called on the complete leaf data
+        if(size / view.itemsize < KERNEL_NOGIL_SIZE) {
+            _kernel_take(dst, src, indices->data(), count, outer, dim, inner, 1);
+
+        } else {
+            Py_BEGIN_ALLOW_THREADS
+            _kernel_take(dst, src, indices->data(), count, outer, dim, inner, 0);
+            Py_END_ALLOW_THREADS
+        }
+
+        PyBuffer_Release(&view);
+
+    } else {
+        copies.jobs.push_back({dst, src, outer, dim, inner});
+        copies.views.push_back(view);
+        copies.numel += size / view.itemsize;
+
+    }
+
+    PyObject *result = PyMemoryView_FromObject(data);
+    Py_DECREF(data);
+
+    if(committer == NULL || result == NULL)
+        return result;
+
+    Py_SETREF(result, PyObject_CallWithSingleArg(committer, result, NULL));
+
+    return result;
+}
+
+
+PyObject* take(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    // `take(main, indices, /, *, axis=0, committer=None)`
+    if(nargs != 2) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "take() takes exactly 2 positional arguments (%zd given)", nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"axis", "committer", NULL};
+
+    PyObject *own[] = {NULL, NULL};
+    if(!PyArg_ScanKwnames("take", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    int axis = 0;
+    if(!_ops_parse_axis(own[0], axis))
+        return NULL;
+
+    PyObject *committer = own[1] == Py_None ? NULL : own[1];
+    if(committer != NULL && !PyCallable_Check(committer)) {
+        PyErr_SetString(PyExc_TypeError, "The committer must be a callable.");
+        return NULL;
+    }
+
+    std::vector<Py_ssize_t> indices = {};
+    if(!_ops_indices(args[1], indices))
+        return NULL;
+
+    PyObject *key = _ops_key(args[1], axis);
+    if(key == NULL)
+        return NULL;
+
+    taker policy = {axis, key, &indices, committer, {{}, {}, 0}};
+
+    // the rows are copied after the traversal, and with all threads at once
+    PyObject *result = _traverse(policy, args[0], NULL, 0);
+    if(result != NULL) {
+        if(policy.copies.numel < KERNEL_NOGIL_SIZE) {
+            policy.copies.run(indices, 1);
+
+        } else {
+            Py_BEGIN_ALLOW_THREADS
+            policy.copies.run(indices, 0);
+            Py_END_ALLOW_THREADS
+        }
+    }
+
+    policy.copies.release();
+    Py_DECREF(key);
+
+    return result;
+}
+
+
+// the policy of `_traverse` for `put`, which checks all leaves before
+//  writing any, so that a mismatch leaves the structure intact
+struct putter {
+    int axis;
+    PyObject *key;
+    const std::vector<Py_ssize_t> *indices;
+
+    // whether the values have no axis, i.e. a single row is put
+    bool single;
+
+    // the rows copied into the buffers when the traversal is over, with the
+    //  views of both the storage and the values
+    rowcopies copies;
+
+    // the pairs of the leaves and their values to be set by `key` (owned)
+    std::vector<PyObject *> deferred;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], true);
+        if(!_traverse_validate(frame.kind, row, 1))
+            return 0;
+
+        return _traverse_enter(frame, row[0], false);
+    }
+
+    int matches(const Py_buffer &view, const Py_buffer &value);
+
+    PyObject* defer(PyObject **row);
+
+    PyObject* leaf(PyObject **row);
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 2, false, true);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        Py_RETURN_NONE;
+    }
+
+    int write();
+
+    void release()
+    {
+        copies.release();
+        for(PyObject *item : deferred)
+            Py_DECREF(item);
+
+        deferred.clear();
+    }
+};
+
+
+int putter::matches(const Py_buffer &view, const Py_buffer &value)
+{
+    // check if the value has the format and the shape of the rows of the
+    //  storage, and is a C-contiguous buffer not overlapping with it
+    if(
+        value.itemsize != view.itemsize
+        || !_ops_same_format(_ops_format(value), _ops_format(view))
+        || !PyBuffer_IsContiguous(&value, 'C')
+    )
+        return 0;
+
+    if(value.ndim != (single ? view.ndim - 1 : view.ndim))
+        return 0;
+
+    for(int k = 0, j = 0; k < view.ndim; k++) {
+        if(k == axis) {
+            if(!single && value.shape[j++] != (Py_ssize_t) indices->size())
+                return 0;
+
+        } else if(value.shape[j++] != view.shape[k]) {
+            return 0;
+
+        }
+    }
+
+    const char *lo = (const char *) view.buf, *hi = lo + view.len;
+    const char *vlo = (const char *) value.buf, *vhi = vlo + value.len;
+
+    return vhi <= lo || hi <= vlo;
+}
+
+
+PyObject* putter::defer(PyObject **row)
+{
+    try {
+        deferred.reserve(deferred.size() + 2);
+
+    } catch(const std::bad_alloc &) {
+        return PyErr_NoMemory();
+
+    }
+
+    Py_INCREF(row[0]);
+    deferred.push_back(row[0]);
+
+    Py_INCREF(row[1]);
+    deferred.push_back(row[1]);
+
+    Py_RETURN_NONE;
+}
+
+
+PyObject* putter::leaf(PyObject **row)
+{
+    // the values of the writable C-contiguous buffers are copied into their
+    //  rows, and the other leaves are set with `key`, e.g. the python
+    //  scalars, the values of another dtype, or the broadcasts, but only
+    //  after the traversal is over
+    Py_buffer view, value;
+    if(PyObject_GetBuffer(row[0], &view, PyBUF_RECORDS) < 0) {
+        PyErr_Clear();
+        return defer(row);
+    }
+
+    Py_ssize_t outer, dim, inner;
+    if(
+        !PyBuffer_IsContiguous(&view, 'C')
+        || !_ops_axis(view, axis, outer, dim, inner)
+    ) {
+        PyBuffer_Release(&view);
+        return defer(row);
+    }
+
+    if(!_ops_check_bounds(*indices, axis, dim)) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+
+    if(PyObject_GetBuffer(row[1], &value, PyBUF_RECORDS_RO) < 0) {
+        PyErr_Clear();
+        PyBuffer_Release(&view);
+        return defer(row);
+    }
+
+    if(!matches(view, value)) {
+        PyBuffer_Release(&value);
+        PyBuffer_Release(&view);
+        return defer(row);
+    }
+
+    try {
+        copies.views.reserve(copies.views.size() + 2);
+        copies.jobs.reserve(copies.jobs.size() + 1);
+
+    } catch(const std::bad_alloc &) {
+        PyBuffer_Release(&value);
+        PyBuffer_Release(&view);
+        return PyErr_NoMemory();
+
+    }
+
+    // `put` reads from `src` into the rows of `dst`, unlike `take`
+    copies.views.push_back(view);
+    copies.views.push_back(value);
+    copies.jobs.push_back(
+        {(char *) view.buf, (const char *) value.buf, outer, dim, inner});
+    copies.numel += outer * indices->size() * inner / view.itemsize;
+
+    Py_RETURN_NONE;
+}
+
+
+int putter::write()
+{
+    // the leaves set by `key` go first, since only they may fail midway
+    for(size_t j = 0; j < deferred.size(); j += 2)
+        if(PyObject_SetItem(deferred[j], key, deferred[j + 1]) < 0)
+            return 0;
+
+    // the large copies are made by several threads and without the GIL
+    unsigned threads = 1;
+    PyThreadState *state = NULL;
+    if(copies.numel >= KERNEL_NOGIL_SIZE) {
+        threads = 0;
+        state = PyEval_SaveThread();
+    }
+
+    for(const rowcopy &job : copies.jobs)
+        _kernel_put(
+            job.dst, job.src, indices->data(), indices->size(),
+            job.outer, job.dim, job.inner, threads);
+
+    if(state != NULL)
+        PyEval_RestoreThread(state);
+
+    return 1;
+}
+
+
+static bool _ops_scalar_index(PyObject *obj)
+{
+    // python ints and numpy integer scalars, and also the 0-d buffers, e.g.
+    //  `np.array(3)`, which are sequences, but have no axis to index
+    if(!PyIndex_Check(obj))
+        return false;
+
+    if(!PySequence_Check(obj))
+        return true;
+
+    Py_buffer view;
+    if(PyObject_GetBuffer(obj, &view, PyBUF_ND) < 0) {
+        PyErr_Clear();
+        return false;
+    }
+
+    bool scalar = view.ndim == 0;
+    PyBuffer_Release(&view);
+
+    return scalar;
+}
+
+
+PyObject* put(
+    PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames)
+{
+    // `put(main, values, index, /, *, axis=0)`
+    if(nargs != 3) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "put() takes exactly 3 positional arguments (%zd given)", nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"axis", NULL};
+
+    PyObject *own[] = {NULL};
+    if(!PyArg_ScanKwnames("put", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    int axis = 0;
+    if(!_ops_parse_axis(own[0], axis))
+        return NULL;
+
+    // an integer index puts a single row, and the others put a row each
+    std::vector<Py_ssize_t> indices = {};
+    bool single = _ops_scalar_index(args[2]);
+    if(single) {
+        Py_ssize_t pos = PyNumber_AsSsize_t(args[2], PyExc_IndexError);
+        if(pos == -1 && PyErr_Occurred())
+            return NULL;
+
+        indices.push_back(pos);
+
+    } else if(!_ops_indices(args[2], indices)) {
+        return NULL;
+
+    }
+
+    PyObject *key = _ops_key(args[2], axis);
+    if(key == NULL)
+        return NULL;
+
+    putter policy = {axis, key, &indices, single, {{}, {}, 0}, {}};
+
+    // the structures are validated and the bounds checked before any write
+    PyObject *result = _traverse(policy, args[0], args + 1, 1);
+    if(result != NULL && !policy.write())
+        Py_CLEAR(result);
+
+    policy.release();
+    Py_DECREF(key);
+
+    return result;
+}
+
+
+const PyMethodDef def_take = {
+    "take",
+    (PyCFunction) (void(*)(void)) take,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "take(struct, indices, *, axis=0, committer=None)\n"
+        "\n"
+        "Gather the rows at `indices` along the `axis` from the leaves of\n"
+        "the nested object, e.g. to sample a minibatch from a replay buffer.\n"
+        "Each leaf that exposes a buffer with the axis becomes a memoryview\n"
+        "of a new C-contiguous buffer with the rows, or the value of\n"
+        "`committer` on it, e.g. `np.asarray`. The rows of C-contiguous\n"
+        "buffers are copied with several threads and without the GIL. The\n"
+        "other leaves are indexed with `leaf[indices]`, or\n"
+        "`leaf[:, ..., :, indices]` for `axis > 0`, and are not committed.\n"
+    ),
+};
+
+
+const PyMethodDef def_put = {
+    "put",
+    (PyCFunction) (void(*)(void)) put,
+    METH_FASTCALL | METH_KEYWORDS,
+    PyDoc_STR(
+        "put(struct, values, index, *, axis=0)\n"
+        "\n"
+        "Write the leaves of `values` into the rows at `index` along the\n"
+        "`axis` of the leaves of the nested object `struct`, which have the\n"
+        "same structure, e.g. to store a transition in a replay buffer. An\n"
+        "integer `index`, or a 0-d buffer of one, writes a single row, and\n"
+        "a 1d buffer or a sequence of integers writes a row from each slice\n"
+        "of the values along the axis. The values are copied into writable\n"
+        "C-contiguous buffers of the same format and matching shape\n"
+        "directly, with the large ones copied by several threads and without\n"
+        "the GIL. The other leaves are set by `leaf[index] = value`, or\n"
+        "`leaf[:, ..., :, index]` for `axis > 0`. The last of the rows with\n"
+        "duplicate indices is the one written, like in numpy. Nothing is\n"
+        "written unless the nested objects have the same structure and the\n"
+        "indices are within the bounds of every buffer. Returns None.\n"
+    ),
+};
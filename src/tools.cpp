@@ -1,4 +1,17 @@
 #include <Python.h>
+#include <vector>
+#include <unordered_map>
+
+#include <tools.h>
+
+// bpo-39749: the vectorcall API is public since 3.9, but has been available
+//  under provisional names in 3.8
+#if PY_VERSION_HEX >= 0x03080000 && PY_VERSION_HEX < 0x03090000
+#   define PyObject_VectorcallDict _PyObject_FastCallDict
+#endif
+
+// vectorcall arrays up to this size are kept on the stack
+#define SMALL_STACK 8
 
 
 PyObject *PyObject_CallWithSingleArg(
@@ -6,8 +19,17 @@ PyObject *PyObject_CallWithSingleArg(
     PyObject *arg,
     PyObject *kwargs)
 {
-    // much like `PyObject_CallOneArg`, but with optional kwargs:
-    //   create a one-element tuple, then call with it and kwargs
+    // much like `PyObject_CallOneArg`, but with optional kwargs
+#if PY_VERSION_HEX >= 0x03080000
+    // the vectorcall protocol takes a borrowed C array of arguments, and the
+    //  leading slot allows the callee to prepend `self` in-place (bound methods)
+    PyObject *stack[2] = {NULL, arg};
+
+    return PyObject_VectorcallDict(
+        callable, stack + 1, 1 | PY_VECTORCALL_ARGUMENTS_OFFSET, kwargs);
+
+#else
+    // create a one-element tuple, then call with it and kwargs
     PyObject *single = PyTuple_New(1);
     if(single == NULL) return NULL;
 
@@ -29,6 +51,63 @@ PyObject *PyObject_CallWithSingleArg(
     Py_DECREF(single);
 
     return output;
+#endif
+}
+
+
+PyObject *PyObject_CallWithArgs(
+    PyObject *callable,
+    PyObject *arg,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    PyObject *kwargs)
+{
+    // call `callable(arg, *rest, **kwargs)` with borrowed `arg` and `rest`
+#if PY_VERSION_HEX >= 0x03080000
+    // the arguments are laid out after a spare leading slot, which vectorcall
+    //  may temporarily overwrite (see `PY_VECTORCALL_ARGUMENTS_OFFSET`)
+    PyObject *small[SMALL_STACK];
+    std::vector<PyObject *> large = {};
+
+    PyObject **stack = small;
+    if(len + 2 > SMALL_STACK) {
+        large.resize(len + 2);
+        stack = large.data();
+    }
+
+    stack[0] = NULL;
+    stack[1] = arg;
+    for(Py_ssize_t j = 0; j < len; j++)
+        stack[j + 2] = rest[j];
+
+    // the callee borrows the arguments, so we keep `arg` alive in case it
+    //  gets evicted from its container during the call (`rest` is owned by
+    //  the caller for the duration of the call)
+    Py_INCREF(arg);
+    PyObject *output = PyObject_VectorcallDict(
+        callable, stack + 1, (1 + len) | PY_VECTORCALL_ARGUMENTS_OFFSET, kwargs);
+    Py_DECREF(arg);
+
+    return output;
+
+#else
+    PyObject *item_, *args = PyTuple_New(1 + len);
+    if(args == NULL) return NULL;
+
+    Py_INCREF(arg);
+    PyTuple_SET_ITEM(args, 0, arg);
+    for(Py_ssize_t j = 0; j < len; j++) {
+        item_ = rest[j];
+
+        Py_INCREF(item_);
+        PyTuple_SET_ITEM(args, j + 1, item_);
+    }
+
+    PyObject *output = PyObject_Call(callable, args, kwargs);
+    Py_DECREF(args);
+
+    return output;
+#endif
 }
 
 
@@ -84,7 +163,220 @@ PyObject* PyTuple_Clone(PyObject *tuple)
 }
 
 
-int PyNamedTuple_CheckExact(PyObject *p)
+PyObject* PyTuple_FromItems(PyObject *const *items, Py_ssize_t len)
+{
+    // make a tuple of borrowed `items`, e.g. the positionals of a fastcall
+    PyObject *tuple = PyTuple_New(len);
+    if(tuple == NULL)
+        return NULL;
+
+    for(Py_ssize_t j = 0; j < len; j++) {
+        PyObject *item = items[j];
+
+        Py_INCREF(item);
+        PyTuple_SET_ITEM(tuple, j, item);
+    }
+
+    return tuple;
+}
+
+
+// 3.14 caches the hash of a tuple in the object, so a tuple may no longer be
+//  refilled after it has been passed to python
+#if PY_VERSION_HEX < 0x030E0000
+#   define TUPLE_RECYCLE
+#endif
+
+
+PyObject* PyTuple_FromPool(
+    PyObject **pool,
+    PyObject *arg,
+    PyObject *const *rest,
+    Py_ssize_t len)
+{
+    // a new ref to the tuple `(arg, *rest)`, which is taken from the `pool`,
+    //  an owned ref to a tuple of NULLs or NULL, if it has the right size
+    PyObject *args = *pool;
+    if(args != NULL && PyTuple_GET_SIZE(args) == 1 + len) {
+        *pool = NULL;
+
+    } else {
+        args = PyTuple_New(1 + len);
+        if(args == NULL)
+            return NULL;
+    }
+
+    Py_INCREF(arg);
+    PyTuple_SET_ITEM(args, 0, arg);
+    for(Py_ssize_t j = 0; j < len; j++) {
+        PyObject *item = rest[j];
+
+        Py_INCREF(item);
+        PyTuple_SET_ITEM(args, j + 1, item);
+    }
+
+    return args;
+}
+
+
+void PyTuple_ToPool(PyObject **pool, PyObject *args)
+{
+    // release the tuple of `PyTuple_FromPool`, or put it back into the pool,
+    //  if the callables have not kept a ref to it
+#ifdef TUPLE_RECYCLE
+    // clear the items, so that the pooled tuple does not keep the leaf data
+    //  alive, but only if nobody else can see the tuple being mutated
+    if(Py_REFCNT(args) == 1 && *pool == NULL) {
+        for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(args); j++) {
+            PyObject *item = PyTuple_GET_ITEM(args, j);
+
+            PyTuple_SET_ITEM(args, j, NULL);
+            Py_DECREF(item);
+        }
+
+        *pool = args;
+
+        return;
+    }
+#endif
+
+    Py_DECREF(args);
+}
+
+
+PyObject* PyObject_CallWithPackedArgs(
+    PyObject *callable,
+    PyObject *arg,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    PyObject *kwargs,
+    PyObject **pool)
+{
+    // call `callable((arg, *rest), **kwargs)` with the tuple taken from the
+    //  `pool`, so that a traversal allocates one tuple for all of its leaves
+    PyObject *args = PyTuple_FromPool(pool, arg, rest, len);
+    if(args == NULL)
+        return NULL;
+
+    PyObject *output = PyObject_CallWithSingleArg(callable, args, kwargs);
+    PyTuple_ToPool(pool, args);
+
+    return output;
+}
+
+
+int PyArg_ScanKwnames(
+    const char *fname,
+    PyObject *const *kwvalues,
+    PyObject *kwnames,
+    const char *keys[],
+    PyObject **values,
+    PyObject **kwargs)
+{
+    // Match the keyword names of a METH_FASTCALL call against the NULL-
+    //  terminated `keys`, and put the borrowed values of the matched ones into
+    //  `values` at the same position. The unmatched keywords are collected in
+    //  a new dict in `kwargs`, unless it is NULL, in which case they raise.
+    // XXX this replaces `PyArg_ParseTupleAndKeywords`, which needs a tuple and
+    //  a dict of its own options, and so costs more than a small nested call.
+    if(kwnames == NULL)
+        return 1;
+
+    Py_ssize_t len = PyTuple_GET_SIZE(kwnames);
+    for(Py_ssize_t j = 0; j < len; j++) {
+        PyObject *name = PyTuple_GET_ITEM(kwnames, j);
+
+        // identifiers are almost always compact ascii strings, the data of
+        //  which is null-terminated, and a non-ascii name cannot be ours
+        int p = 0;
+        if(PyUnicode_IS_COMPACT_ASCII(name)) {
+            const char *data = (const char *) PyUnicode_DATA(name);
+            for(; keys[p] != NULL; p++)
+                if(strcmp(data, keys[p]) == 0)
+                    break;
+        } else {
+            for(; keys[p] != NULL; p++);
+        }
+
+        if(keys[p] != NULL) {
+            values[p] = kwvalues[j];
+            continue;
+        }
+
+        if(kwargs == NULL) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "%s() got an unexpected keyword argument '%U'", fname, name);
+            return 0;
+        }
+
+        if(*kwargs == NULL) {
+            *kwargs = PyDict_New();
+            if(*kwargs == NULL)
+                return 0;
+        }
+
+        if(PyDict_SetItem(*kwargs, name, kwvalues[j]) < 0) {
+            Py_CLEAR(*kwargs);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+int PyArg_ParseFlag(PyObject *value, int *flag)
+{
+    // much like the "p" format unit: leave the default if the value is absent
+    if(value == NULL)
+        return 1;
+
+    int truth = PyObject_IsTrue(value);
+    if(truth < 0)
+        return 0;
+
+    *flag = truth;
+    return 1;
+}
+
+
+// the kinds of subtypes of `tuple` told apart by `PyNamedTuple_CheckExact`,
+//  keyed by type, and the weakrefs, which evict the dead heap types
+typedef struct {
+    int kind;
+    PyObject *weakref;
+} tupletype;
+
+static std::unordered_map<PyTypeObject *, tupletype> _tuple_types;
+
+// the number of types above which new ones are checked, but not cached
+#define TUPLE_TYPES_SIZE 1024
+
+
+static PyObject* _tuple_types_evict(PyObject *key, PyObject *weakref)
+{
+    // the weakref's callback, which runs when the type is being deallocated,
+    //  so that its address could not be mistaken for a new type's later on
+    auto it = _tuple_types.find((PyTypeObject *) PyLong_AsVoidPtr(key));
+    if(it != _tuple_types.end() && it->second.weakref == weakref) {
+        _tuple_types.erase(it);
+        Py_DECREF(weakref);
+    }
+
+    Py_RETURN_NONE;
+}
+
+
+static PyMethodDef _tuple_types_evict_def = {
+    "_tuple_types_evict",
+    (PyCFunction) _tuple_types_evict,
+    METH_O,
+    NULL,
+};
+
+
+static int _tuple_type_kind(PyTypeObject *type)
 {
     // "isinstance(o, tuple) and hasattr(o, '_fields')" is the recommended way
     // to check if an object is a namedtuple, however we also verify that the
@@ -93,22 +385,126 @@ int PyNamedTuple_CheckExact(PyObject *p)
     // guaranteed).
     //     https://mail.python.org/pipermail//python-ideas/2014-January/024886.html
     //     https://docs.python.org/3/c-api/typeobj.html#c.PyTypeObject.tp_mro
-    if(!PyTuple_Check(p))
-        return 0;
+    if(type == &PyTuple_Type)
+        return TUPLE_PLAIN;
 
-    if(PyTuple_GET_SIZE(Py_TYPE(p)->tp_mro) != 3)
-        return 0;
+    if(PyTuple_GET_SIZE(type->tp_mro) != 3)
+        return TUPLE_FOREIGN;
 
     if(
-        (const PyTypeObject*) PyTuple_GET_ITEM(Py_TYPE(p)->tp_mro, 1)
+        (const PyTypeObject*) PyTuple_GET_ITEM(type->tp_mro, 1)
             != &PyTuple_Type
     )
-        return 0;
+        return TUPLE_FOREIGN;
 
-    if(!PyObject_HasAttrString(p, "_fields"))
+    // `namedtuple` has empty `__slots__`, so instances have no own `_fields`
+    if(PyObject_HasAttrString((PyObject *) type, "_fields"))
+        return TUPLE_NAMEDTUPLE;
+
+    // the instances of the other subtypes may still have `_fields` of their
+    //  own, or through `__getattr__`, in which case each one is checked
+    if(type->tp_dictoffset != 0 || type->tp_getattro != PyObject_GenericGetAttr)
+        return TUPLE_INSTANCE;
+
+    return TUPLE_FOREIGN;
+}
+
+
+int PyTuple_TypeKind(PyTypeObject *type)
+{
+    // the kind of a subtype of `tuple`, which is looked up once per type
+    auto it = _tuple_types.find(type);
+    if(it != _tuple_types.end())
+        return it->second.kind;
+
+    int kind = _tuple_type_kind(type);
+    if(_tuple_types.size() >= TUPLE_TYPES_SIZE)
+        return kind;
+
+    // static types are never deallocated, but the heap types, including all
+    //  namedtuples, may be, and their entries are evicted by a weakref
+    PyObject *weakref = NULL;
+    if(type->tp_flags & Py_TPFLAGS_HEAPTYPE) {
+        PyObject *key = PyLong_FromVoidPtr(type);
+        if(key == NULL) {
+            PyErr_Clear();
+            return kind;
+        }
+
+        PyObject *callback = PyCFunction_New(&_tuple_types_evict_def, key);
+        Py_DECREF(key);
+        if(callback == NULL) {
+            PyErr_Clear();
+            return kind;
+        }
+
+        weakref = PyWeakref_NewRef((PyObject *) type, callback);
+        Py_DECREF(callback);
+        if(weakref == NULL) {
+            // the type does not support weakrefs, so it is not cached
+            PyErr_Clear();
+            return kind;
+        }
+    }
+
+    _tuple_types[type] = {kind, weakref};
+
+    return kind;
+}
+
+
+void PyTuple_ClearTypeKinds(void)
+{
+    // drop the cached kinds, e.g. when the module is freed, the weakrefs of
+    //  which go away together with their callbacks
+    for(auto &item : _tuple_types)
+        Py_XDECREF(item.second.weakref);
+
+    _tuple_types.clear();
+}
+
+
+int PyNamedTuple_CheckExact(PyObject *p)
+{
+    // see `_tuple_type_kind`
+    if(!PyTuple_Check(p))
         return 0;
 
-    return 1;
+    int kind = PyTuple_TypeKind(Py_TYPE(p));
+    if(kind != TUPLE_INSTANCE)
+        return kind == TUPLE_NAMEDTUPLE;
+
+    return PyObject_HasAttrString(p, "_fields");
+}
+
+
+PyObject* PyNamedTuple_New(PyTypeObject *type, Py_ssize_t len)
+{
+    // a new namedtuple of `type` with `len` NULL items to be filled in place
+    //  (cf. `tuple_subtype_new` in CPython's `Objects/tupleobject.c`), or
+    //  a plain tuple to be passed to `PyNamedTuple_Finish` once filled
+#ifdef NAMEDTUPLE_INPLACE
+    return type->tp_alloc(type, len);
+#else
+    return PyTuple_New(len);
+#endif
+}
+
+
+PyObject* PyNamedTuple_Finish(PyTypeObject *type, PyObject *output)
+{
+    // make the namedtuple from the `output` of `PyNamedTuple_New`, stealing
+    //  the ref to it
+#ifndef NAMEDTUPLE_INPLACE
+    if(output != NULL) {
+        PyObject *namedtuple = type->tp_new(type, output, NULL);
+        Py_DECREF(output);
+
+        output = namedtuple;
+    }
+#endif
+
+    return output;
 }
 
 
@@ -0,0 +1,295 @@
+#include <Python.h>
+
+#include <transpose.h>
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+#include <treedef.h>
+
+
+PyDoc_STRVAR(
+    transpose__doc__,
+    "\n"
+    "transpose(objects, /, *, _safe=True, _strict=True)\n"
+    "\n"
+    "Turn a sequence of nested objects into a nested object of sequences.\n"
+    "\n"
+    "Parameters\n"
+    "----------\n"
+    "objects : sequence of nested objects\n"
+    "    The non-empty sequence of nested objects with identical structure.\n"
+    "\n"
+    "_safe, _strict : bool, default=True\n"
+    "    See `.apply`.\n"
+    "\n"
+    "Returns\n"
+    "-------\n"
+    "result : nested object\n"
+    "    The nested object with the structure of the first object, each leaf\n"
+    "    of which is an `AtomicList` of the corresponding leaves of all\n"
+    "    objects in order.\n"
+    "\n"
+    "Details\n"
+    "-------\n"
+    "The sequence is read directly, and the objects are traversed jointly\n"
+    "once, so that\n"
+    "\n"
+    ">>> plyr.apply(np.stack, plyr.transpose(results), axis=0)\n"
+    "\n"
+    "is equivalent to, but is faster on long sequences than\n"
+    "\n"
+    ">>> plyr.apply(np.stack, *results, _star=False, axis=0)\n"
+    "\n"
+    "Since `AtomicList` is a subtype of `list`, the leaves are not descended\n"
+    "into by `apply` and the other functions with `_strict=True`.\n"
+    "\n"
+);
+
+
+PyDoc_STRVAR(
+    untranspose__doc__,
+    "\n"
+    "untranspose(struct, /, *, _strict=True)\n"
+    "\n"
+    "Turn a nested object of sequences into a list of nested objects.\n"
+    "\n"
+    "Parameters\n"
+    "----------\n"
+    "struct : nested object\n"
+    "    The nested object, the leaves of which are sequences of the same\n"
+    "    length, e.g. `AtomicList`-s made by `transpose`, or arrays.\n"
+    "\n"
+    "_strict : bool, default=True\n"
+    "    See `.apply`. NOTE the leaves are determined as in `.apply`, hence\n"
+    "    plain lists and tuples are treated as nested containers.\n"
+    "\n"
+    "Returns\n"
+    "-------\n"
+    "result : list of nested objects\n"
+    "    The list of nested objects with the structure of `struct`, the k-th\n"
+    "    of which has the k-th items of the sequences as its leaves. It is\n"
+    "    empty if `struct` has no leaves.\n"
+    "\n"
+);
+
+
+// the policy of `_traverse` for `transpose`
+struct transposer {
+    bool safe, strict;
+
+    // the number of objects in a row
+    Py_ssize_t width;
+
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        frame.kind = _traverse_kind(row[0], strict);
+        if(safe && !_traverse_validate(frame.kind, row, width - 1))
+            return 0;
+
+        return _traverse_enter(frame, row[0]);
+    }
+
+    PyObject* leaf(PyObject **row)
+    {
+        // an empty instance of the list subtype, which is grown by appends
+        PyObject *column = AtomicList.tp_alloc(&AtomicList, 0);
+        if(column == NULL)
+            return NULL;
+
+        for(Py_ssize_t j = 0; j < width; j++) {
+            if(PyList_Append(column, row[j]) < 0) {
+                Py_DECREF(column);
+                return NULL;
+            }
+        }
+
+        return column;
+    }
+
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, width, false, safe);
+    }
+
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        return _traverse_finish(frame, NULL);
+    }
+};
+
+
+static PyObject* _transpose(
+    PyObject *const *objects,
+    Py_ssize_t len,
+    const bool safe,
+    const bool strict)
+{
+    // the objects are traversed jointly like in `apply`, but the leaves are
+    //  collected into a list instead of being passed to a callable
+    transposer policy = {safe, strict, len};
+
+    return _traverse(policy, objects[0], objects + 1, len - 1);
+}
+
+
+static PyObject* _untranspose(
+    PyObject *main,
+    const bool strict)
+{
+    // flatten the sequences along the plan of the structure
+    std::vector<PyObject *> leaves = {};
+    PyTreeDefObject *plan = _treedef_cached_gather(
+        main, NULL, 0, strict, false, leaves);
+    if(plan == NULL)
+        return NULL;
+
+    Py_ssize_t numel = plan->num_leaves, count = 0;
+
+    // the leaves of the k-th object
+    std::vector<PyObject *> row(numel, NULL);
+
+    PyObject *result = NULL;
+    for(Py_ssize_t pos = 0; pos < numel; pos++) {
+        PyObject *seq = PySequence_Fast(
+            leaves[pos], "The leaves must be sequences.");
+        if(seq == NULL)
+            goto finally;
+
+        Py_SETREF(leaves[pos], seq);
+        if(pos == 0) {
+            count = PySequence_Fast_GET_SIZE(seq);
+
+        } else if(PySequence_Fast_GET_SIZE(seq) != count) {
+            PyErr_Format(
+                PyExc_ValueError,
+                "The leaves must have the same length (%zd != %zd).",
+                PySequence_Fast_GET_SIZE(seq), count);
+            goto finally;
+
+        }
+    }
+
+    result = PyList_New(count);
+    if(result == NULL)
+        goto finally;
+
+    // the items of the sequences are borrowed by the rows, and are increfed
+    //  when they are put into the new nested objects
+    for(Py_ssize_t k = 0; k < count; k++) {
+        for(Py_ssize_t pos = 0; pos < numel; pos++)
+            row[pos] = PySequence_Fast_GET_ITEM(leaves[pos], k);
+
+        PyObject *item = _treedef_unflatten(plan, row.data(), numel);
+        if(item == NULL) {
+            Py_CLEAR(result);
+            goto finally;
+        }
+
+        PyList_SET_ITEM(result, k, item);
+    }
+
+finally:
+    for(PyObject *leaf : leaves)
+        Py_DECREF(leaf);
+
+    Py_DECREF(plan);
+
+    return result;
+}
+
+
+PyObject* transpose(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    int safe = 1, strict = 1;
+
+    if(nargs != 1) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "transpose() takes exactly 1 positional argument (%zd given)", nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"_safe", "_strict", NULL};
+
+    PyObject *own[] = {NULL, NULL};
+    if(!PyArg_ScanKwnames("transpose", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    if(!PyArg_ParseFlag(own[0], &safe) || !PyArg_ParseFlag(own[1], &strict))
+        return NULL;
+
+    // lists and tuples are used as they are, other iterables are copied
+    PyObject *seq = PySequence_Fast(args[0], "The argument must be iterable.");
+    if(seq == NULL)
+        return NULL;
+
+    PyObject *result = NULL;
+    Py_ssize_t len = PySequence_Fast_GET_SIZE(seq);
+    if(len > 0) {
+        // a list may be changed by the code called during the traversal
+        PyObject *objects = PyList_Check(seq) ? PyList_AsTuple(seq) : seq;
+        if(objects != seq)
+            Py_SETREF(seq, objects);
+
+        if(objects != NULL)
+            result = _transpose(
+                PySequence_Fast_ITEMS(objects), len, safe, strict);
+
+    } else {
+        PyErr_SetString(PyExc_ValueError, "Cannot transpose an empty sequence.");
+
+    }
+
+    Py_XDECREF(seq);
+
+    return result;
+}
+
+
+PyObject* untranspose(
+    PyObject *self,
+    PyObject *const *args,
+    Py_ssize_t nargs,
+    PyObject *kwnames)
+{
+    int strict = 1;
+
+    if(nargs != 1) {
+        PyErr_Format(
+            PyExc_TypeError,
+            "untranspose() takes exactly 1 positional argument (%zd given)",
+            nargs);
+        return NULL;
+    }
+
+    static const char *kwlist[] = {"_strict", NULL};
+
+    PyObject *own[] = {NULL};
+    if(!PyArg_ScanKwnames("untranspose", args + nargs, kwnames, kwlist, own, NULL))
+        return NULL;
+
+    if(!PyArg_ParseFlag(own[0], &strict))
+        return NULL;
+
+    return _untranspose(args[0], strict);
+}
+
+
+const PyMethodDef def_transpose = {
+    "transpose",
+    (PyCFunction) (void(*)(void)) transpose,
+    METH_FASTCALL | METH_KEYWORDS,
+    transpose__doc__,
+};
+
+
+const PyMethodDef def_untranspose = {
+    "untranspose",
+    (PyCFunction) (void(*)(void)) untranspose,
+    METH_FASTCALL | METH_KEYWORDS,
+    untranspose__doc__,
+};
@@ -0,0 +1,74 @@
+#include <Python.h>
+
+#include <tools.h>
+#include <validate.h>
+#include <traverse.h>
+
+
+PyObject* _traverse_finish(
+    travframe &frame,
+    PyObject *finalizer)
+{
+    // take the output from the frame, namedtuples included, which have been
+    //  allocated with their own type by `_traverse_enter`, if possible
+    PyObject *output = frame.output;
+    frame.output = NULL;
+#ifndef NAMEDTUPLE_INPLACE
+    if(frame.kind == NODE_NAMEDTUPLE)
+        output = PyNamedTuple_Finish(frame.type, output);
+#endif
+
+    // The finalizer is only called on the inner/nested containers, and never
+    //  on the leaf data
+    if(finalizer == NULL || output == NULL)
+        return output;
+
+    PyObject *result = PyObject_CallWithSingleArg(finalizer, output, NULL);
+    Py_DECREF(output);
+
+    return result;
+}
+
+
+
+
+void _traverse_release(travpath &frames, std::vector<PyObject *> &rows)
+{
+    // decref the partially built outputs and the objects on the path, some of
+    //  which may be NULL
+    for(travframe &frame : frames) {
+        Py_XDECREF(frame.key);
+        Py_XDECREF(frame.output);
+    }
+
+    for(PyObject *item : rows)
+        Py_XDECREF(item);
+
+    frames.clear();
+    rows.clear();
+}
+
+
+int _traverse_ancestors(
+    const travpath &frames,
+    const std::vector<PyObject *> &rows,
+    Py_ssize_t width,
+    std::unordered_set<PyObject *> &ancestors)
+{
+    // add the main object of the innermost container to those of the other
+    //  containers on the path, or of all of them, if they are not tracked
+    //  yet. The main object of the k-th frame is in the k-th row.
+    size_t first = ancestors.empty() ? 0 : frames.size() - 1;
+    for(size_t k = first; k < frames.size(); k++) {
+        PyObject *main = rows[k * width + frames[k].index];
+        if(!ancestors.insert(main).second) {
+            PyErr_Format(
+                PyExc_RecursionError,
+                "The nested object contains itself in a '%s'.",
+                Py_TYPE(main)->tp_name);
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,1110 @@
+#include <Python.h>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <tools.h>
+#include <treedef.h>
+
+
+PyDoc_STRVAR(
+    __doc__,
+    "\n"
+    "TreeDef(struct, *, _strict=True)\n"
+    "\n"
+    "The compiled skeletal structure of a nested object.\n"
+    "\n"
+    "Unlike the skeleton returned by `flatten`, the compiled structure keeps\n"
+    "only the kinds, types and sizes of the nested containers and the keys of\n"
+    "dicts, and NEVER holds references to the leaf data.\n"
+    "\n"
+    "Parameters\n"
+    "----------\n"
+    "struct : nested object\n"
+    "    The nested object, the structure of which is compiled (the leaf data\n"
+    "    is ignored).\n"
+    "\n"
+    "_strict : bool, default=True\n"
+    "    Whether to treat the subtypes of built-in containers as non-leaf nested\n"
+    "    containers and descend into them. See `.apply`.\n"
+    "\n"
+    "Details\n"
+    "-------\n"
+    "The containers are dispatched exactly like in `.apply`, hence\n"
+    "\n"
+    ">>> td = TreeDef(struct)\n"
+    ">>> td.unflatten(map(fn, td.flatten(struct)))\n"
+    "\n"
+    "is equivalent to `apply(fn, struct)`.\n"
+    "\n"
+    "The compiled structures are equal if their containers have the same\n"
+    "types and sizes, and their dicts have equal keys, and equal structures\n"
+    "hash the same, e.g. to be the keys of a dict.\n"
+    "\n"
+);
+
+
+static int _treedef_kind(PyObject *main, const bool strict)
+{
+    // the same dispatch order as in `_apply`
+    if(PyDict_CheckExact(main) || (!strict && PyDict_Check(main)))
+        return TREEDEF_DICT;
+
+    if(PyTuple_CheckExact(main))
+        return TREEDEF_TUPLE;
+
+    if(PyNamedTuple_CheckExact(main))
+        return TREEDEF_NAMEDTUPLE;
+
+    if(!strict && PyTuple_Check(main))
+        return TREEDEF_TUPLE;
+
+    if(PyList_CheckExact(main) || (!strict && PyList_Check(main)))
+        return TREEDEF_LIST;
+
+    return TREEDEF_LEAF;
+}
+
+
+static inline PyObject* _treedef_child(
+    PyObject *obj,
+    const treenode &node,
+    Py_ssize_t pos)
+{
+    // returns a borrowed reference, or NULL (without an exception) if a dict
+    //  has no key at the specified position of the node
+    switch(node.kind) {
+        case TREEDEF_DICT:
+            return PyDict_GetItem(obj, PyTuple_GET_ITEM(node.keys, pos));
+
+        case TREEDEF_LIST:
+            return PyList_GET_ITEM(obj, pos);
+
+        default:
+            return PyTuple_GET_ITEM(obj, pos);
+    }
+}
+
+
+static void _treedef_release(std::vector<treenode> &nodes)
+{
+    for(treenode &node : nodes) {
+        Py_XDECREF(node.type);
+        Py_XDECREF(node.keys);
+    }
+
+    nodes.clear();
+}
+
+
+// the position of the traversal within a container
+typedef struct {
+    PyObject *obj;
+    size_t node;
+    Py_ssize_t pos;
+} treecursor;
+
+
+// the containers on the path are tracked for reference cycles only past this
+//  depth, like in `_traverse`
+#define TREEDEF_CYCLE_DEPTH 64
+
+
+static int _treedef_walk(
+    PyObject *main,
+    const bool strict,
+    std::vector<treenode> &nodes,
+    std::vector<PyObject *> &keys,
+    Py_ssize_t *num_leaves)
+{
+    // collect the BORROWED types and keys of the nested object in depth-first
+    //  pre-order (the keys of each dict are contiguous)
+
+    // the container, its `PyDict_Next` position or index, and the number of
+    //  children left to visit
+    typedef struct {
+        PyObject *obj;
+        int kind;
+        Py_ssize_t pos;
+        Py_ssize_t left;
+    } walkcursor;
+
+    std::vector<walkcursor> stack = {};
+
+    // the containers on the path past the cycle depth
+    std::unordered_set<PyObject *> ancestors = {};
+
+    PyObject *obj = main, *key, *value;
+    try {
+        while(true) {
+            treenode node = {_treedef_kind(obj, strict), 0, NULL, NULL};
+            switch(node.kind) {
+                case TREEDEF_DICT: {
+                    node.numel = PyDict_Size(obj);
+
+                    Py_ssize_t pos = 0;
+                    while(PyDict_Next(obj, &pos, &key, &value))
+                        keys.push_back(key);
+                    break;
+                }
+
+                case TREEDEF_LIST:
+                    node.numel = PyList_GET_SIZE(obj);
+                    break;
+
+                case TREEDEF_LEAF:
+                    ++*num_leaves;
+                    break;
+
+                default:
+                    node.numel = PyTuple_GET_SIZE(obj);
+            }
+
+            if(node.kind != TREEDEF_LEAF)
+                node.type = Py_TYPE(obj);
+
+            nodes.push_back(node);
+            if(node.numel > 0)
+                stack.push_back({obj, node.kind, 0, node.numel});
+
+            // a nested object, which contains itself, is infinitely deep
+            if(node.numel > 0 && stack.size() > TREEDEF_CYCLE_DEPTH) {
+                size_t first = ancestors.empty() ? 0 : stack.size() - 1;
+                for(size_t k = first; k < stack.size(); k++) {
+                    if(!ancestors.insert(stack[k].obj).second) {
+                        PyErr_Format(
+                            PyExc_RecursionError,
+                            "The nested object contains itself in a '%s'.",
+                            Py_TYPE(stack[k].obj)->tp_name);
+                        return 0;
+                    }
+                }
+            }
+
+            // pop the exhausted containers and descend into the next child
+            while(!stack.empty() && stack.back().left == 0) {
+                if(stack.size() > TREEDEF_CYCLE_DEPTH) {
+                    ancestors.erase(stack.back().obj);
+
+                } else if(!ancestors.empty()) {
+                    ancestors.clear();
+
+                }
+
+                stack.pop_back();
+            }
+
+            if(stack.empty())
+                break;
+
+            walkcursor &top = stack.back();
+            top.left--;
+            if(top.kind == TREEDEF_DICT) {
+                PyDict_Next(top.obj, &top.pos, &key, &obj);
+
+            } else if(top.kind == TREEDEF_LIST) {
+                obj = PyList_GET_ITEM(top.obj, top.pos++);
+
+            } else {
+                obj = PyTuple_GET_ITEM(top.obj, top.pos++);
+
+            }
+        }
+
+    } catch(const std::bad_alloc &) {
+        PyErr_NoMemory();
+        return 0;
+
+    }
+
+    return 1;
+}
+
+
+static PyObject* _treedef_alloc(
+    const std::vector<treenode> &nodes,
+    const std::vector<PyObject *> &keys,
+    Py_ssize_t num_leaves,
+    const bool strict)
+{
+    // make a new compiled structure from the walked nodes, which get owned
+    PyTypeObject *type = &PyTreeDef_Type;
+    PyTreeDefObject *self = (PyTreeDefObject *) type->tp_alloc(type, 0);
+    if(self == NULL)
+        return NULL;
+
+    try {
+        self->nodes = new std::vector<treenode>(nodes);
+
+    } catch(const std::bad_alloc &) {
+        Py_DECREF(self);
+        PyErr_NoMemory();
+        return NULL;
+
+    }
+
+    self->num_leaves = num_leaves;
+    self->strict = strict;
+    self->hash = -1;
+
+    // become the owner of the types before anything could fail
+    for(treenode &node : *self->nodes)
+        Py_XINCREF(node.type);
+
+    size_t offset = 0;
+    for(treenode &node : *self->nodes) {
+        if(node.kind != TREEDEF_DICT)
+            continue;
+
+        node.keys = PyTuple_New(node.numel);
+        if(node.keys == NULL) {
+            Py_DECREF(self);
+            return NULL;
+        }
+
+        for(Py_ssize_t pos = 0; pos < node.numel; pos++) {
+            PyObject *key = keys[offset++];
+
+            Py_INCREF(key);
+            PyTuple_SET_ITEM(node.keys, pos, key);
+        }
+    }
+
+    return (PyObject *) self;
+}
+
+
+PyObject* _treedef_new(
+    PyObject *main,
+    const bool strict)
+{
+    std::vector<treenode> nodes = {};
+    std::vector<PyObject *> keys = {};
+
+    Py_ssize_t num_leaves = 0;
+    if(!_treedef_walk(main, strict, nodes, keys, &num_leaves))
+        return NULL;
+
+    return _treedef_alloc(nodes, keys, num_leaves, strict);
+}
+
+
+static int _treedef_check(
+    const treenode &node,
+    PyObject *obj)
+{
+    // like `_validate_*` the containers must have exactly the same type
+    if(!Py_IS_TYPE(obj, node.type)) {
+        char error[160];
+        PyOS_snprintf(error, 160, "Expected '%s', got '%s'",
+                      node.type->tp_name, Py_TYPE(obj)->tp_name);
+
+        PyErr_SetString(PyExc_TypeError, error);
+        return 0;
+    }
+
+    Py_ssize_t numel;
+    if(node.kind == TREEDEF_DICT) {
+        numel = PyDict_Size(obj);
+
+    } else if(node.kind == TREEDEF_LIST) {
+        numel = PyList_GET_SIZE(obj);
+
+    } else {
+        numel = PyTuple_GET_SIZE(obj);
+
+    }
+
+    if(numel != node.numel) {
+        char error[160];
+        PyOS_snprintf(error, 160, "'%s' size mismatch", node.type->tp_name);
+
+        PyErr_SetString(PyExc_RuntimeError, error);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+static PyObject* _treedef_cleared()
+{
+    // the structure released by the garbage collector has no nodes
+    PyErr_SetString(PyExc_ValueError, "The TreeDef has been cleared.");
+    return NULL;
+}
+
+
+PyObject* _treedef_flatten(
+    PyTreeDefObject *self,
+    PyObject *main,
+    const bool safe)
+{
+    const std::vector<treenode> &nodes = *self->nodes;
+    if(nodes.empty())
+        return _treedef_cleared();
+
+    // the leaves are put directly into a presized list
+    PyObject *output = PyList_New(self->num_leaves);
+    if(output == NULL)
+        return NULL;
+
+    std::vector<treecursor> stack = {};
+
+    Py_ssize_t leaf = 0;
+    PyObject *obj = main;
+    for(size_t j = 0; j < nodes.size(); j++) {
+        const treenode &node = nodes[j];
+        if(!stack.empty()) {
+            treecursor &top = stack.back();
+            const treenode &parent = nodes[top.node];
+
+            obj = _treedef_child(top.obj, parent, top.pos);
+            if(obj == NULL) {
+                PyErr_SetObject(
+                    PyExc_KeyError, PyTuple_GET_ITEM(parent.keys, top.pos));
+
+                Py_DECREF(output);
+                return NULL;
+            }
+
+            top.pos++;
+        }
+
+        if(node.kind == TREEDEF_LEAF) {
+            // all items of `main` are borrowed, and the list steals refs
+            Py_INCREF(obj);
+            PyList_SET_ITEM(output, leaf++, obj);
+
+        } else {
+            // unsafe flattening assumes `minimality' just like `_apply`
+            if(safe && !_treedef_check(node, obj)) {
+                Py_DECREF(output);
+                return NULL;
+            }
+
+            if(node.numel > 0)
+                stack.push_back({obj, j, 0});
+        }
+
+        while(!stack.empty() && stack.back().pos == nodes[stack.back().node].numel)
+            stack.pop_back();
+    }
+
+    return output;
+}
+
+
+static PyObject* _treedef_new_container(const treenode &node)
+{
+    switch(node.kind) {
+        case TREEDEF_DICT:
+            return _PyDict_NewPresized(node.numel);
+
+        case TREEDEF_LIST:
+            return PyList_New(node.numel);
+
+        case TREEDEF_NAMEDTUPLE:
+            // see the note on namedtuples in `_traverse_new`
+            return PyNamedTuple_New(node.type, node.numel);
+
+        default:
+            return PyTuple_New(node.numel);
+    }
+}
+
+
+static int _treedef_store(
+    PyObject *output,
+    const treenode &node,
+    Py_ssize_t pos,
+    PyObject *result)
+{
+    // steals the reference to `result` even on failure
+    int status = 0;
+    switch(node.kind) {
+        case TREEDEF_DICT:
+            status = PyDict_SetItem(
+                output, PyTuple_GET_ITEM(node.keys, pos), result);
+
+            Py_DECREF(result);
+            break;
+
+        case TREEDEF_LIST:
+            PyList_SET_ITEM(output, pos, result);
+            break;
+
+        default:
+            PyTuple_SET_ITEM(output, pos, result);
+    }
+
+    return status == 0;
+}
+
+
+static PyObject* _treedef_finish(
+    const treenode &node,
+    PyObject *output,
+    PyObject *finalizer)
+{
+    // steals the reference to the rebuilt `output` container
+#ifndef NAMEDTUPLE_INPLACE
+    if(node.kind == TREEDEF_NAMEDTUPLE)
+        output = PyNamedTuple_Finish(node.type, output);
+#endif
+
+    if(finalizer == NULL || output == NULL)
+        return output;
+
+    // the finalizer is only called on the rebuilt containers
+    PyObject *result = PyObject_CallWithSingleArg(finalizer, output, NULL);
+    Py_DECREF(output);
+
+    return result;
+}
+
+
+PyObject* _treedef_unflatten(
+    PyTreeDefObject *self,
+    PyObject *const *leaves,
+    Py_ssize_t len,
+    PyObject *finalizer)
+{
+    const std::vector<treenode> &nodes = *self->nodes;
+    if(nodes.empty())
+        return _treedef_cleared();
+
+    if(len != self->num_leaves) {
+        PyErr_Format(PyExc_RuntimeError, "Expected %zd leaves, got %zd",
+                     self->num_leaves, len);
+        return NULL;
+    }
+
+    // the containers being rebuilt, paired with their nodes
+    std::vector<treecursor> stack = {};
+
+    Py_ssize_t leaf = 0;
+    PyObject *result = NULL;
+    for(size_t j = 0; j < nodes.size(); j++) {
+        const treenode &node = nodes[j];
+        if(node.kind == TREEDEF_LEAF) {
+            result = leaves[leaf++];
+            Py_INCREF(result);
+
+        } else {
+            result = _treedef_new_container(node);
+            if(result == NULL)
+                goto error;
+
+            if(node.numel > 0) {
+                stack.push_back({result, j, 0});
+                continue;
+            }
+
+            result = _treedef_finish(node, result, finalizer);
+            if(result == NULL)
+                goto error;
+        }
+
+        // put the complete object into its parent, and finish the parents
+        //  which have been fully rebuilt
+        while(!stack.empty()) {
+            treecursor &top = stack.back();
+            const treenode &parent = nodes[top.node];
+            if(!_treedef_store(top.obj, parent, top.pos++, result))
+                goto error;
+
+            if(top.pos < parent.numel)
+                break;
+
+            result = _treedef_finish(parent, top.obj, finalizer);
+            stack.pop_back();
+            if(result == NULL)
+                goto error;
+        }
+    }
+
+    return result;
+
+error:
+    for(treecursor &top : stack)
+        Py_DECREF(top.obj);
+
+    return NULL;
+}
+
+
+static int _treedef_gather_children(
+    const treenode &node,
+    PyObject *const *containers,
+    PyObject **row,
+    Py_ssize_t count,
+    Py_ssize_t *pos,
+    Py_ssize_t index)
+{
+    // put the `index`-th children of the containers into the `row`
+    if(node.kind == TREEDEF_LIST) {
+        for(Py_ssize_t k = 0; k < count; k++)
+            row[k] = PyList_GET_ITEM(containers[k], index);
+
+        return 1;
+
+    } else if(node.kind != TREEDEF_DICT) {
+        for(Py_ssize_t k = 0; k < count; k++)
+            row[k] = PyTuple_GET_ITEM(containers[k], index);
+
+        return 1;
+    }
+
+    // the keys of the first container are checked in order against the plan,
+    //  since they dictate the order and the keys of the output. A mismatch
+    //  is -1, while an error is 0.
+    PyObject *key, *expected = PyTuple_GET_ITEM(node.keys, index);
+    if(!PyDict_Next(containers[0], pos, &key, &row[0]))
+        return -1;
+
+    if(key != expected) {
+        // equal keys are interchangeable in the output only if they are exact
+        //  strs or ints, e.g. not `1` and `1.0`, or `1` and `True`, so the
+        //  other keys must be the very same objects
+        if(
+            !Py_IS_TYPE(key, Py_TYPE(expected))
+            || !(PyUnicode_CheckExact(key) || PyLong_CheckExact(key))
+        )
+            return -1;
+
+        int equal = PyObject_RichCompareBool(key, expected, Py_EQ);
+        if(equal <= 0)
+            return equal == 0 ? -1 : 0;
+    }
+
+    for(Py_ssize_t k = 1; k < count; k++) {
+        row[k] = PyDict_GetItem(containers[k], key);
+        if(row[k] == NULL) {
+            PyErr_SetObject(PyExc_KeyError, key);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+static int _treedef_gather(
+    PyTreeDefObject *self,
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    const bool safe,
+    std::vector<PyObject *> &leaves)
+{
+    // Jointly flatten the objects along the plan, appending NEW references
+    //  to their leaves in [leaf][object] order. Returns -1 without an exception
+    //  if the structure of the first object does not match the plan, and 0
+    //  with an exception if the others do not match the first one.
+    const std::vector<treenode> &nodes = *self->nodes;
+
+    // the node, `PyDict_Next` position in the first container and the index
+    //  of the next child
+    typedef struct {
+        size_t node;
+        Py_ssize_t pos;
+        Py_ssize_t index;
+    } gathercursor;
+
+    std::vector<gathercursor> stack = {};
+
+    // the containers of each frame on the stack, and the current children
+    Py_ssize_t count = 1 + len;
+    std::vector<PyObject *> frames = {}, row = {main};
+    row.insert(row.end(), rest, rest + len);
+
+    leaves.reserve(self->num_leaves * count);
+
+    int status = 1;
+    for(size_t j = 0; j < nodes.size(); j++) {
+        const treenode &node = nodes[j];
+        if(!stack.empty()) {
+            gathercursor &top = stack.back();
+            status = _treedef_gather_children(
+                nodes[top.node], &frames[frames.size() - count],
+                row.data(), count, &top.pos, top.index++);
+            if(status <= 0)
+                break;
+        }
+
+        main = row[0];
+        if(node.kind == TREEDEF_LEAF) {
+            if(_treedef_kind(main, self->strict) != TREEDEF_LEAF) {
+                status = -1;
+                break;
+            }
+
+            for(Py_ssize_t k = 0; k < count; k++) {
+                Py_INCREF(row[k]);
+                leaves.push_back(row[k]);
+            }
+
+        } else {
+            Py_ssize_t numel;
+            if(node.kind == TREEDEF_DICT) {
+                numel = PyDict_Size(main);
+
+            } else if(node.kind == TREEDEF_LIST) {
+                numel = PyList_GET_SIZE(main);
+
+            } else {
+                numel = PyTuple_GET_SIZE(main);
+
+            }
+
+            // the type is exact, so if it is a namedtuple, then it still is
+            if(!Py_IS_TYPE(main, node.type) || numel != node.numel) {
+                status = -1;
+                break;
+            }
+
+            if(safe) {
+                for(Py_ssize_t k = 1; k < count && status; k++)
+                    status = _treedef_check(node, row[k]);
+
+                if(!status)
+                    break;
+            }
+
+            if(node.numel > 0) {
+                stack.push_back({j, 0, 0});
+                frames.insert(frames.end(), row.begin(), row.end());
+            }
+        }
+
+        while(!stack.empty() && stack.back().index == nodes[stack.back().node].numel) {
+            stack.pop_back();
+            frames.resize(frames.size() - count);
+        }
+    }
+
+    if(status <= 0) {
+        for(PyObject *leaf : leaves)
+            Py_DECREF(leaf);
+
+        leaves.clear();
+    }
+
+    return status;
+}
+
+
+// the plans compiled by `_treedef_cached_gather`, keyed by the fingerprints
+//  of the outermost containers in most-recently-used order
+static std::unordered_map<Py_hash_t, std::vector<PyObject *>> _treedef_cache;
+
+// the maximal number of plans per fingerprint, and the number of fingerprints
+//  above which the cache is flushed
+#define TREEDEF_CACHE_WAYS 4
+#define TREEDEF_CACHE_SIZE 256
+
+
+static Py_uhash_t _treedef_fingerprint_node(Py_uhash_t hash, PyObject *obj)
+{
+    // mix the type and the size of a container, or the type of a leaf
+    hash = (hash ^ (Py_uhash_t) Py_TYPE(obj)) * 1000003UL;
+
+    if(PyDict_Check(obj)) {
+        hash = (hash ^ (Py_uhash_t) PyDict_Size(obj)) * 1000003UL;
+
+    } else if(PyTuple_Check(obj)) {
+        hash = (hash ^ (Py_uhash_t) PyTuple_GET_SIZE(obj)) * 1000003UL;
+
+    } else if(PyList_Check(obj)) {
+        hash = (hash ^ (Py_uhash_t) PyList_GET_SIZE(obj)) * 1000003UL;
+
+    }
+
+    return hash;
+}
+
+
+// the number of the children of the outermost container in the fingerprint
+#define TREEDEF_FINGERPRINT_WIDTH 16
+
+
+static Py_hash_t _treedef_fingerprint(PyObject *main, const bool strict)
+{
+    // a cheap fingerprint: the type and the size of `main`, and the types and
+    //  sizes of its first few children, which tells apart the structures of
+    //  the same outer container, e.g. dicts of different records
+    Py_uhash_t hash = strict ? 0x345678UL : 0x27d4eb2dUL;
+    hash = _treedef_fingerprint_node(hash, main);
+
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    if(PyDict_Check(main)) {
+        for(int j = 0; j < TREEDEF_FINGERPRINT_WIDTH; j++) {
+            if(!PyDict_Next(main, &pos, &key, &value))
+                break;
+
+            hash = _treedef_fingerprint_node(hash, value);
+        }
+
+    } else if(PyTuple_Check(main) || PyList_Check(main)) {
+        Py_ssize_t numel = PySequence_Fast_GET_SIZE(main);
+        PyObject **items = PySequence_Fast_ITEMS(main);
+        for(; pos < numel && pos < TREEDEF_FINGERPRINT_WIDTH; pos++)
+            hash = _treedef_fingerprint_node(hash, items[pos]);
+
+    }
+
+    return (Py_hash_t) hash;
+}
+
+
+PyTreeDefObject* _treedef_cached_gather(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    const bool strict,
+    const bool safe,
+    std::vector<PyObject *> &leaves)
+{
+    // Look up the plan of `main`'s structure in the cache, and jointly flatten
+    //  it with the `rest` along it (see `_treedef_gather`). A new plan is
+    //  compiled, if none of the cached plans fit. Returns a new reference.
+    Py_hash_t fingerprint = _treedef_fingerprint(main, strict);
+
+    // comparing keys may call python, so hold on to the candidate plans
+    PyObject *candidates[TREEDEF_CACHE_WAYS];
+    size_t n_candidates = 0;
+
+    auto it = _treedef_cache.find(fingerprint);
+    if(it != _treedef_cache.end()) {
+        for(PyObject *plan : it->second) {
+            Py_INCREF(plan);
+            candidates[n_candidates++] = plan;
+        }
+    }
+
+    int status = -1;
+    size_t j = 0;
+    PyObject *found = NULL;
+    for(; j < n_candidates; j++) {
+        status = _treedef_gather(
+            (PyTreeDefObject *) candidates[j], main, rest, len, safe, leaves);
+        if(status >= 0) {
+            found = status ? candidates[j] : NULL;
+            break;
+        }
+    }
+
+    Py_XINCREF(found);
+    for(size_t k = 0; k < n_candidates; k++)
+        Py_DECREF(candidates[k]);
+
+    if(status == 0)
+        return NULL;
+
+    // the most recently used plan of the fingerprint stays where it is
+    if(found != NULL && j == 0)
+        return (PyTreeDefObject *) found;
+
+    if(found == NULL) {
+        found = _treedef_new(main, strict);
+        if(found == NULL)
+            return NULL;
+
+        status = _treedef_gather(
+            (PyTreeDefObject *) found, main, rest, len, safe, leaves);
+        if(status <= 0) {
+            Py_DECREF(found);
+            return NULL;
+        }
+    }
+
+    // move the plan to the front of its fingerprint's list
+    std::vector<PyObject *> stale = {};
+    if(_treedef_cache.size() >= TREEDEF_CACHE_SIZE) {
+        for(auto &item : _treedef_cache)
+            stale.insert(stale.end(), item.second.begin(), item.second.end());
+
+        _treedef_cache.clear();
+    }
+
+    std::vector<PyObject *> &plans = _treedef_cache[fingerprint];
+    for(auto plan = plans.begin(); plan != plans.end(); plan++) {
+        if(*plan == found) {
+            plans.erase(plan);
+            stale.push_back(found);
+            break;
+        }
+    }
+
+    Py_INCREF(found);
+    plans.insert(plans.begin(), found);
+    if(plans.size() > TREEDEF_CACHE_WAYS) {
+        stale.push_back(plans.back());
+        plans.pop_back();
+    }
+
+    // release the evicted plans only after the cache is consistent
+    for(PyObject *plan : stale)
+        Py_DECREF(plan);
+
+    return (PyTreeDefObject *) found;
+}
+
+
+static PyObject* TreeDef_new(
+    PyTypeObject *type,
+    PyObject *args,
+    PyObject *kwargs)
+{
+    PyObject *main = NULL;
+    int strict = 1;
+
+    static const char *kwlist[] = {"", "_strict", NULL};
+    if(!PyArg_ParseTupleAndKeywords(
+        args, kwargs, "O|$p:TreeDef", (char**) kwlist, &main, &strict
+    ))
+        return NULL;
+
+    return _treedef_new(main, strict);
+}
+
+
+static int TreeDef_traverse(PyTreeDefObject *self, visitproc visit, void *arg)
+{
+    // the heap types and the dict keys may refer back to the structure
+    if(self->nodes == NULL)
+        return 0;
+
+    for(const treenode &node : *self->nodes) {
+        Py_VISIT(node.type);
+        Py_VISIT(node.keys);
+    }
+
+    return 0;
+}
+
+
+static int TreeDef_clear(PyTreeDefObject *self)
+{
+    if(self->nodes != NULL)
+        _treedef_release(*self->nodes);
+
+    self->num_leaves = 0;
+
+    return 0;
+}
+
+
+static void TreeDef_dealloc(PyTreeDefObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    if(self->nodes != NULL) {
+        _treedef_release(*self->nodes);
+        delete self->nodes;
+    }
+
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+
+static PyObject* TreeDef_repr(PyTreeDefObject *self)
+{
+    return PyUnicode_FromFormat(
+        "TreeDef(num_nodes=%zd, num_leaves=%zd)",
+        (Py_ssize_t) self->nodes->size(), self->num_leaves);
+}
+
+
+static Py_hash_t TreeDef_hash(PyTreeDefObject *self)
+{
+    // consistent with the equality: the types by identity, the keys by value
+    if(self->hash != -1)
+        return self->hash;
+
+    Py_uhash_t hash = self->strict ? 0x345678UL : 0x9e3779b9UL;
+    for(const treenode &node : *self->nodes) {
+        hash = (hash ^ (Py_uhash_t) node.kind) * 1000003UL;
+        hash = (hash ^ (Py_uhash_t) node.numel) * 1000003UL;
+        hash = (hash ^ (Py_uhash_t) node.type) * 1000003UL;
+        if(node.keys == NULL)
+            continue;
+
+        Py_hash_t keys = PyObject_Hash(node.keys);
+        if(keys == -1)
+            return -1;
+
+        hash = (hash ^ (Py_uhash_t) keys) * 1000003UL;
+    }
+
+    self->hash = hash == (Py_uhash_t) -1 ? -2 : (Py_hash_t) hash;
+
+    return self->hash;
+}
+
+
+static PyObject* TreeDef_richcompare(
+    PyTreeDefObject *self,
+    PyObject *other,
+    int op)
+{
+    if((op != Py_EQ && op != Py_NE) || !PyTreeDef_Check(other))
+        Py_RETURN_NOTIMPLEMENTED;
+
+    const std::vector<treenode> &a = *self->nodes;
+    const std::vector<treenode> &b = *((PyTreeDefObject *) other)->nodes;
+
+    int equal = (
+        a.size() == b.size()
+        && self->strict == ((PyTreeDefObject *) other)->strict
+    );
+    for(size_t j = 0; equal && j < a.size(); j++) {
+        // container types are compared by identity, dict keys by value
+        equal = (
+            a[j].kind == b[j].kind
+            && a[j].numel == b[j].numel
+            && a[j].type == b[j].type
+        );
+        if(!equal || a[j].keys == b[j].keys)
+            continue;
+
+        equal = PyObject_RichCompareBool(a[j].keys, b[j].keys, Py_EQ);
+        if(equal < 0)
+            return NULL;
+    }
+
+    if(op == Py_NE)
+        equal = !equal;
+
+    return PyBool_FromLong(equal);
+}
+
+
+static PyObject* TreeDef_flatten(PyTreeDefObject *self, PyObject *main)
+{
+    return _treedef_flatten(self, main);
+}
+
+
+static PyObject* TreeDef_unflatten(PyTreeDefObject *self, PyObject *leaves)
+{
+    // tuples and lists are used as is, other iterables are materialized
+    PyObject *seq = PySequence_Fast(leaves, "The leaves must be iterable.");
+    if(seq == NULL)
+        return NULL;
+
+    PyObject *result = _treedef_unflatten(
+        self, PySequence_Fast_ITEMS(seq), PySequence_Fast_GET_SIZE(seq));
+    Py_DECREF(seq);
+
+    return result;
+}
+
+
+static PyObject* TreeDef_get_num_leaves(PyTreeDefObject *self, void *closure)
+{
+    return PyLong_FromSsize_t(self->num_leaves);
+}
+
+
+static PyObject* TreeDef_get_num_nodes(PyTreeDefObject *self, void *closure)
+{
+    return PyLong_FromSize_t(self->nodes->size());
+}
+
+
+static PyMethodDef TreeDef_methods[] = {
+    {
+        "flatten",
+        (PyCFunction) TreeDef_flatten,
+        METH_O,
+        PyDoc_STR(
+            "flatten(object)\n"
+            "\n"
+            "Get the list of leaves of the nested object in depth-first order.\n"
+            "The structure of the object must match the compiled structure,\n"
+            "except for the leaves, which may be arbitrary nested objects."
+        ),
+    }, {
+        "unflatten",
+        (PyCFunction) TreeDef_unflatten,
+        METH_O,
+        PyDoc_STR(
+            "unflatten(leaves)\n"
+            "\n"
+            "Rebuild the compiled structure from the leaves in depth-first\n"
+            "order. The number of leaves must match `num_leaves`."
+        ),
+    }, {
+        NULL,
+        NULL,
+        0,
+        NULL,
+    }
+};
+
+
+static PyGetSetDef TreeDef_getset[] = {
+    {
+        (char*) "num_leaves",
+        (getter) TreeDef_get_num_leaves,
+        NULL,
+        (char*) "The number of leaves in the structure.",
+        NULL,
+    }, {
+        (char*) "num_nodes",
+        (getter) TreeDef_get_num_nodes,
+        NULL,
+        (char*) "The number of containers and leaves in the structure.",
+        NULL,
+    }, {
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+    }
+};
+
+
+PyTypeObject PyTreeDef_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "plyr.TreeDef",                 /* tp_name */
+    sizeof(PyTreeDefObject),        /* tp_basicsize */
+    0,                              /* tp_itemsize */
+    (destructor) TreeDef_dealloc,   /* tp_dealloc */
+    0,                              /* tp_vectorcall_offset */
+    0,                              /* tp_getattr */
+    0,                              /* tp_setattr */
+    0,                              /* tp_as_async */
+    (reprfunc) TreeDef_repr,        /* tp_repr */
+    0,                              /* tp_as_number */
+    0,                              /* tp_as_sequence */
+    0,                              /* tp_as_mapping */
+    (hashfunc) TreeDef_hash,        /* tp_hash */
+    0,                              /* tp_call */
+    0,                              /* tp_str */
+    0,                              /* tp_getattro */
+    0,                              /* tp_setattro */
+    0,                              /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,  /* tp_flags */
+    __doc__,                        /* tp_doc */
+    (traverseproc) TreeDef_traverse,  /* tp_traverse */
+    (inquiry) TreeDef_clear,        /* tp_clear */
+    (richcmpfunc) TreeDef_richcompare,  /* tp_richcompare */
+    0,                              /* tp_weaklistoffset */
+    0,                              /* tp_iter */
+    0,                              /* tp_iternext */
+    TreeDef_methods,                /* tp_methods */
+    0,                              /* tp_members */
+    TreeDef_getset,                 /* tp_getset */
+    0,                              /* tp_base */
+    0,                              /* tp_dict */
+    0,                              /* tp_descr_get */
+    0,                              /* tp_descr_set */
+    0,                              /* tp_dictoffset */
+    0,                              /* tp_init */
+    0,                              /* tp_alloc */
+    (newfunc) TreeDef_new,          /* tp_new */
+};
@@ -1,5 +1,7 @@
 #include <Python.h>
 #include <validate.h>
+#include <tools.h>
+#include <traverse.h>
 
 
 PyDoc_STRVAR(
@@ -56,11 +58,16 @@ int _raise_SizeError(Py_ssize_t index, PyObject *main, objectstack *stack)
 }
 
 
-int _validate_dict(PyObject *main, PyObject *rest, objectstack *stack)
+int _validate_dict(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    objectstack *stack,
+    const bool keys)
 {
     Py_ssize_t numel = PyDict_Size(main);
-    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(rest); ++j) {
-        PyObject *key, *value, *obj = PyTuple_GET_ITEM(rest, j);
+    for(Py_ssize_t j = 0; j < len; ++j) {
+        PyObject *key, *value, *obj = rest[j];
 
         if(!Py_IS_TYPE(obj, Py_TYPE(main)))
             return _raise_TypeError(j+1, main, obj, stack);
@@ -68,6 +75,10 @@ int _validate_dict(PyObject *main, PyObject *rest, objectstack *stack)
         if(numel != PyDict_Size(obj))
             return _raise_SizeError(j+1, main, stack);
 
+        // the keys may be checked later, when the items are being fetched
+        if(!keys)
+            continue;
+
         Py_ssize_t pos = 0;
         while (PyDict_Next(main, &pos, &key, &value)) {
             if(!PyDict_Contains(obj, key)) {
@@ -91,11 +102,15 @@ int _validate_dict(PyObject *main, PyObject *rest, objectstack *stack)
 }
 
 
-int _validate_tuple(PyObject *main, PyObject *rest, objectstack *stack)
+int _validate_tuple(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    objectstack *stack)
 {
     Py_ssize_t numel = PyTuple_GET_SIZE(main);
-    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(rest); ++j) {
-        PyObject *obj = PyTuple_GET_ITEM(rest, j);
+    for(Py_ssize_t j = 0; j < len; ++j) {
+        PyObject *obj = rest[j];
 
         if(!Py_IS_TYPE(obj, Py_TYPE(main)))
             return _raise_TypeError(j+1, main, obj, stack);
@@ -108,11 +123,15 @@ int _validate_tuple(PyObject *main, PyObject *rest, objectstack *stack)
 }
 
 
-int _validate_list(PyObject *main, PyObject *rest, objectstack *stack)
+int _validate_list(
+    PyObject *main,
+    PyObject *const *rest,
+    Py_ssize_t len,
+    objectstack *stack)
 {
     Py_ssize_t numel = PyList_GET_SIZE(main);
-    for(Py_ssize_t j = 0; j < PyTuple_GET_SIZE(rest); ++j) {
-        PyObject *obj = PyTuple_GET_ITEM(rest, j);
+    for(Py_ssize_t j = 0; j < len; ++j) {
+        PyObject *obj = rest[j];
 
         if(!Py_IS_TYPE(obj, Py_TYPE(main)))
             return _raise_TypeError(j+1, main, obj, stack);
@@ -146,125 +165,80 @@ static PyObject* PyList_fromVector(objectstack &stack)
 }
 
 
-static int _validate(PyObject *main, PyObject *rest, objectstack &stack)
-{
-    int result;
-
-    Py_ssize_t len = PyTuple_GET_SIZE(rest);
-    if (len == 0)
-        return 1;
+// the policy of `_traverse` for `validate`, which checks the structure only
+struct validator {
+    Py_ssize_t len;
 
-    PyObject *key, *rest_ = PyTuple_New(len);
-    if(rest_ == NULL)
-        return 0;
+    // the index/key path to the first mismatch followed by the error
+    objectstack &stack;
 
-    PyObject *main_, *item_;
-    if(PyDict_Check(main)) {
-        if(!_validate_dict(main, rest, &stack))
-            return 0;
+    int enter(travframe &frame, PyObject **row, const travpath &path)
+    {
+        PyObject *main = row[0];
+        frame.kind = _traverse_kind(main, false);
 
-        // for each key in the main dict
-        Py_ssize_t pos = 0;
-        while (PyDict_Next(main, &pos, &key, &main_)) {
-            Py_INCREF(key);
-            stack.push_back(key);
+        objectstack error = {};
+        int valid = 1;
+        switch(frame.kind) {
+            case NODE_DICT:
+                valid = _validate_dict(main, row + 1, len, &error);
+                break;
 
-            for(Py_ssize_t j = 0; j < len; j++) {
-                item_ = PyDict_GetItem(PyTuple_GET_ITEM(rest, j), key);
-
-                Py_INCREF(item_);
-                // XXX we're fine here with `PyTuple_SetItem`-s extra safety
-                PyTuple_SetItem(rest_, j, item_);
-            }
-
-            if(Py_EnterRecursiveCall("")) return 0;
-            result = _validate(main_, rest_, stack);
-            Py_LeaveRecursiveCall();
-
-            if(!result) {
-                Py_DECREF(rest_);
-                return 0;
-            }
+            case NODE_TUPLE:
+            case NODE_NAMEDTUPLE:
+                valid = _validate_tuple(main, row + 1, len, &error);
+                break;
 
-            stack.pop_back();
-            Py_DECREF(key);
+            case NODE_LIST:
+                valid = _validate_list(main, row + 1, len, &error);
+                break;
         }
 
-    } else if(PyTuple_Check(main)) {
-        if(!_validate_tuple(main, rest, &stack))
-            return 0;
-
-        for(Py_ssize_t pos = 0; pos < PyTuple_GET_SIZE(main); pos++) {
-            key = PyLong_FromSsize_t(pos);
-            if(key == NULL) {
-                Py_DECREF(rest_);
-                return 0;
-            }
+        if(valid)
+            return _traverse_enter(frame, main, false);
 
-            stack.push_back(key);
+        // the path consists of the keys of dicts and indices into sequences
+        for(const travframe &node : path) {
+            PyObject *key = node.key;
+            if(node.kind == NODE_DICT) {
+                Py_INCREF(key);
 
-            main_ = PyTuple_GET_ITEM(main, pos);
-            for(Py_ssize_t j = 0; j < len; j++) {
-                item_ = PyTuple_GET_ITEM(PyTuple_GET_ITEM(rest, j), pos);
+            } else {
+                key = PyLong_FromSsize_t(node.pos - 1);
 
-                Py_INCREF(item_);
-                PyTuple_SetItem(rest_, j, item_);
             }
 
-            if(Py_EnterRecursiveCall("")) return 0;
-            result = _validate(main_, rest_, stack);
-            Py_LeaveRecursiveCall();
-
-            if(!result) {
-                Py_DECREF(rest_);
-                return 0;
-            }
-
-            stack.pop_back();
-            Py_DECREF(key);
-        }
-
-    } else if(PyList_Check(main)) {
-        if(!_validate_list(main, rest, &stack))
-            return 0;
-
-        for(Py_ssize_t pos = 0; pos < PyList_GET_SIZE(main); pos++) {
-            key = PyLong_FromSsize_t(pos);
+            // the error is raised with the stack released by `validate`
             if(key == NULL) {
-                Py_DECREF(rest_);
+                for(PyObject *item : error)
+                    Py_XDECREF(item);
+
                 return 0;
             }
 
             stack.push_back(key);
+        }
 
-            main_ = PyList_GET_ITEM(main, pos);
-            for(Py_ssize_t j = 0; j < len; j++) {
-                item_ = PyList_GET_ITEM(PyTuple_GET_ITEM(rest, j), pos);
-
-                Py_INCREF(item_);
-                PyTuple_SetItem(rest_, j, item_);
-            }
-
-            if(Py_EnterRecursiveCall("")) return 0;
-            result = _validate(main_, rest_, stack);
-            Py_LeaveRecursiveCall();
+        stack.insert(stack.end(), error.begin(), error.end());
 
-            if(!result) {
-                Py_DECREF(rest_);
-                return 0;
-            }
-
-            stack.pop_back();
-            Py_DECREF(key);
-        }
+        return 0;
+    }
 
+    PyObject* leaf(PyObject **row)
+    {
+        Py_RETURN_NONE;
     }
 
-    // decrefing a tuple also decrefs all its items
-    Py_DECREF(rest_);
+    int next(travframe &frame, PyObject **row, PyObject **row_)
+    {
+        return _traverse_next(frame, row, row_, 1 + len);
+    }
 
-    return 1;
-}
+    PyObject* finish(travframe &frame, PyObject **row)
+    {
+        Py_RETURN_NONE;
+    }
+};
 
 
 PyObject* validate(PyObject *self, PyObject *args)
@@ -282,18 +256,16 @@ PyObject* validate(PyObject *self, PyObject *args)
     if (!parsed)
         return NULL;
 
-    PyObject *rest = PyTuple_GetSlice(args, 1, len);
-    if (rest == NULL)
-        return NULL;
-
     // the vector is adjust a temporary proxy for a list, and thus
     //  steals references
     std::vector<PyObject *> stack = {};
 
     // dfs through the structures: updates stack and set exceptions
     //  in case of an emergency
-    _validate(main, rest, stack);
-    Py_DECREF(rest);
+    validator policy = {len - 1, stack};
+
+    PyObject *result = _traverse(policy, main, &PyTuple_GET_ITEM(args, 1), len - 1);
+    Py_XDECREF(result);
 
     if(PyErr_Occurred() != NULL) {
         for(Py_ssize_t j = 0; j < stack.size(); ++j)
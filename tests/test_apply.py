@@ -0,0 +1,63 @@
+from collections import namedtuple
+
+import pytest
+
+import plyr
+
+P = namedtuple("P", "x y")
+
+
+@pytest.mark.parametrize('struct', [
+    1,
+    [],
+    [1, (2, 3), {'a': 4, 'b': [5]}],
+    {'p': P(1, [2, P(3, 4.0)]), 'e': (), 'l': [P(5, 6)]},
+])
+def test_cache_agrees_with_apply(struct):
+    for _ in range(3):
+        assert plyr.apply(str, struct, _cache=True) == plyr.apply(str, struct)
+
+
+def test_cache_keeps_the_callers_keys():
+    # equal keys of different types are distinct in the output
+    assert plyr.apply(str, {1: 'a'}, _cache=True) == {1: 'a'}
+    for key in [1.0, True, 1]:
+        res = plyr.apply(str, {key: 'a'}, _cache=True)
+        assert type(next(iter(res))) is type(key)
+
+
+def test_cache_equal_str_keys():
+    # equal str keys, which are different objects, hit the same plan
+    k1, k2 = "".join(["ab", "c"]), "".join(["a", "bc"])
+    assert plyr.apply(str, {k1: 1}, _cache=True) == {"abc": "1"}
+    assert plyr.apply(str, {k2: 2}, _cache=True) == {"abc": "2"}
+
+
+def test_cache_misses_on_a_different_structure():
+    # the same fingerprint, but a different structure deeper down
+    a = [[1, [2]], 3]
+    b = [[1, (2,)], 3]
+    assert plyr.apply(str, a, _cache=True) == [['1', ['2']], '3']
+    assert plyr.apply(str, b, _cache=True) == [['1', ('2',)], '3']
+    assert plyr.apply(str, a, _cache=True) == [['1', ['2']], '3']
+
+
+def test_cache_validates_the_other_objects():
+    with pytest.raises(KeyError):
+        plyr.apply(max, {'a': 1}, {'b': 2}, _cache=True)
+
+    with pytest.raises(TypeError):
+        plyr.apply(max, [1], (2,), _cache=True)
+
+
+def test_namedtuple_fields_per_instance():
+    class Tuple(tuple):
+        pass
+
+    # a tuple subtype without class-level `_fields` is checked per instance
+    plain, named = Tuple((1, 2)), Tuple((3, 4))
+    named._fields = ("a", "b")
+    res = plyr.apply(str, [plain, named])
+    assert res[0] == "(1, 2)"
+    assert type(res[1]) is Tuple and res[1] == ("3", "4")
+    assert plyr.apply(str, P(1, 2)) == P("1", "2")
@@ -0,0 +1,49 @@
+from collections import namedtuple
+from functools import partial
+
+import pytest
+
+import plyr
+
+
+P = namedtuple("P", "x y")
+
+
+def test_chainapply_composes_stages():
+    x = {"a": [1, (2, 3)], "b": P(4, [5])}
+    y = {"a": [6, (7, 8)], "b": P(9, [0])}
+
+    res = plyr.chainapply((max, partial(pow, 2), str), x, y)
+    assert res == plyr.apply(str, plyr.apply(partial(pow, 2), plyr.apply(max, x, y)))
+    assert type(res["b"]) is P
+
+    # no stages take the leaves of the first object as they are
+    assert plyr.chainapply((), x, y) == x
+    assert plyr.chainapply([len], x, x, _star=False) == plyr.apply(
+        len, x, x, _star=False)
+
+    with pytest.raises(TypeError):
+        plyr.chainapply((str, None), x)
+
+    with pytest.raises(TypeError):
+        plyr.chainapply((str,), x, [1])
+
+
+def test_lazy_pipeline():
+    x = [1, {"a": 2, "b": (3,)}]
+    stages = lambda v: v + 1, lambda v: v * 10
+    pipe = plyr.lazy(x).map(stages[0])
+    assert pipe.map(stages[1]).compute() == [20, {"a": 30, "b": (40,)}]
+
+    # the pipelines share their first stages, and are not changed by `.map`
+    assert pipe.compute() == [2, {"a": 3, "b": (4,)}]
+    assert pipe.map(round, ndigits=-1).compute() == [0, {"a": 0, "b": (0,)}]
+    assert plyr.lazy(x, x).map(max).compute() == x
+    assert plyr.lazy(x).compute() == x
+    assert "map" in repr(pipe)
+
+    with pytest.raises(TypeError):
+        plyr.lazy()
+
+    with pytest.raises(TypeError):
+        pipe.map(1)
@@ -0,0 +1,40 @@
+from collections import namedtuple
+
+import pytest
+
+import plyr
+
+
+P = namedtuple("P", "x y")
+
+
+def test_multiapply_matches_apply():
+    x = {"a": [1, (2, 3)], "b": P(4, [5]), "c": {}}
+    y = {"a": [6, (7, 8)], "b": P(9, [10]), "c": {}}
+    callables = (max, min, lambda *a: sum(a))
+
+    results = plyr.multiapply(callables, x, y)
+    assert isinstance(results, tuple) and len(results) == len(callables)
+    for fn, res in zip(callables, results):
+        assert res == plyr.apply(fn, x, y)
+        assert type(res["b"]) is P
+
+    # the outputs are distinct objects
+    assert results[0]["a"] is not results[1]["a"]
+
+
+def test_multiapply_options():
+    x = [1, (2, 3)]
+    assert plyr.multiapply([str], 0) == ("0",)
+    assert plyr.multiapply([], x) == ()
+    assert plyr.multiapply([len], x, x, _star=False) == ([2, (2, 2)],)
+    assert plyr.multiapply([round], [1.25], ndigits=1) == ([1.2],)
+
+    with pytest.raises(TypeError, match="callables"):
+        plyr.multiapply([str, 1], x)
+
+    with pytest.raises(TypeError):
+        plyr.multiapply([str], x, [1, [2, 3]])
+
+    with pytest.raises(ZeroDivisionError):
+        plyr.multiapply([str, lambda v: 1 / 0], x)
@@ -0,0 +1,112 @@
+import ctypes
+import pytest
+import numpy as np
+
+from plyr import ops
+
+
+def test_add_mismatched_shapes_raise():
+    # same dtype and byte length, but the shapes do not broadcast
+    x, y = np.arange(6.).reshape(3, 2), np.arange(6.).reshape(2, 3)
+    with pytest.raises(ValueError):
+        ops.add(x, y)
+
+    with pytest.raises(ValueError):
+        ops.add({'a': x}, {'a': y})
+
+
+def test_add_broadcasts_same_size_shapes():
+    # same dtype and byte length, but the shapes broadcast to (6, 6)
+    x, y = np.arange(6.), np.arange(6.).reshape(6, 1)
+    res = ops.add(x, y)
+    assert res.shape == (6, 6)
+    assert np.array_equal(res, x + y)
+
+    res = ops.add([x], [y])
+    assert np.array_equal(res[0], x + y)
+
+
+@pytest.mark.parametrize('dtype', [np.float32, np.float64])
+def test_max_propagates_nan(dtype):
+    x = np.arange(40, dtype=dtype)
+    for k in range(len(x)):
+        y = x.copy()
+        y[k] = np.nan
+        assert np.isnan(ops.max([x, y]))
+        assert np.isnan(ops.reduce_norm({'a': -y}, ord=float('inf')))
+
+    assert ops.max([x, x[::3]]) == 39
+    assert np.isnan(ops.max([1.0, float('nan'), 0.5]))
+
+
+def test_put_repeated_indices_last_wins():
+    # large enough to be split across threads
+    x = np.zeros((1000, 256), np.float32)
+    values = np.arange(4096 * 256, dtype=np.float32).reshape(4096, 256)
+    index = np.arange(4096) % 7
+
+    ops.put(x, values, index)
+    expected = np.zeros_like(x)
+    expected[index] = values
+    assert np.array_equal(x, expected)
+
+
+def test_put_checks_every_leaf_before_writing():
+    x = {'a': np.zeros(4), 'b': np.zeros(4), 'c': [np.zeros(4)]}
+    with pytest.raises(TypeError):
+        ops.put(x, {'a': 1., 'b': 2., 'c': (3.,)}, 1)
+
+    with pytest.raises(IndexError):
+        ops.put([np.zeros(8), x['a'], np.zeros(2)], [1., 2., 3.], 5)
+
+    assert not any(map(np.any, [x['a'], x['b'], x['c'][0]]))
+
+
+def test_put_zero_dim_index():
+    x = [np.zeros((4, 3)), np.zeros(4, np.int32)]
+    ops.put(x, [np.ones(3), 7], np.array(2))
+    ops.put(x, [np.full(3, 2.), 5], np.int64(1))
+    assert np.array_equal(x[0][:, 0], [0, 2, 1, 0])
+    assert np.array_equal(x[1], [0, 5, 7, 0])
+
+
+def test_reductions_of_int_and_bool_buffers():
+    x = {'i': np.arange(-3, 5), 'b': np.array([True, False, True]), 'f': 0.5}
+    assert ops.sum(x) == 4 + 2 + 0.5
+    assert ops.max(x) == 4
+    assert ops.reduce_norm(x, ord=1) == 16 + 2 + 0.5
+    assert ops.reduce_norm(x, ord=float('inf')) == 4
+    assert np.isclose(ops.reduce_norm(x), np.sqrt(44 + 2 + 0.25))
+    assert ops.dot([np.arange(4)], [np.arange(4)]) == 14
+
+    with pytest.raises(TypeError, match='not supported'):
+        ops.sum(['a'])
+
+
+def test_reductions_of_buffers_without_strides():
+    # ctypes arrays export no strides, against a strided numpy array
+    y = (ctypes.c_double * 4)(1., 2., 3., 4.)
+    x = np.arange(8.)[::2]
+    assert ops.dot(x, y) == 0 * 1 + 2 * 2 + 4 * 3 + 6 * 4
+    assert ops.dot(y, x) == ops.dot(x, y)
+    assert ops.sum(y) == 10.
+
+
+@pytest.mark.parametrize('n', [10, 100000])
+def test_inplace_overlapping_operands(n):
+    a = np.arange(n, dtype=np.float64)
+    b = a.copy()
+    ops.add(a[1:], a[:-1], inplace=True)
+    np.add(b[1:], b[:-1], out=b[1:])
+    assert np.array_equal(a, b)
+
+    a = np.arange(n, dtype=np.float32)
+    b = a.copy()
+    ops.axpy(2., a[:-1], a[1:], inplace=True)
+    b[1:] += 2 * b[:-1]
+    assert np.array_equal(a, b)
+
+    # the same buffer is fine for the kernels
+    a = np.arange(n, dtype=np.float64)
+    ops.mul(a, a, inplace=True)
+    assert np.array_equal(a, np.arange(n, dtype=np.float64) ** 2)
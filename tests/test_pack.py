@@ -0,0 +1,45 @@
+import pytest
+import numpy as np
+
+import plyr
+
+
+def test_pack_unpack_roundtrip():
+    tree = {
+        "w": np.arange(6, dtype=np.float32).reshape(2, 3),
+        "b": (np.ones(2, np.float32),),
+        "s": [np.float32(5)],
+    }
+    flat, layout = plyr.pack(tree)
+    assert flat.format == "f" and flat.nbytes == 36
+    assert np.array_equal(flat, np.r_[np.arange(6), 1, 1, 5])
+
+    out = plyr.unpack(flat, layout)
+    assert plyr.apply(np.shape, out) == plyr.apply(np.shape, tree)
+    assert all(plyr.flatten(plyr.apply(np.array_equal, out, tree))[0])
+
+    # the views share the memory of the flat buffer
+    np.asarray(flat)[:] = 0
+    assert not np.any(out["w"]) and not np.any(out["b"][0])
+
+
+def test_pack_mixed_formats_are_aligned():
+    tree = [np.arange(3, dtype=np.int8), np.arange(2.), np.ones((2, 2), bool)]
+    flat, (skeleton, entries) = plyr.pack(tree)
+    assert flat.format == "B" and skeleton == [None, None, None]
+    assert [e[0] for e in entries] == [0, 8, 24]
+    assert [e[0] % e[2] for e in entries] == [0, 0, 0]
+
+    out = plyr.unpack(flat, (skeleton, entries))
+    for a, b in zip(out, tree):
+        assert np.asarray(a).dtype == b.dtype
+        assert np.array_equal(a, b)
+
+
+def test_unpack_readonly_and_errors():
+    flat, layout = plyr.pack({"a": np.arange(4.)})
+    out = plyr.unpack(bytes(flat), layout)
+    assert out["a"].readonly and out["a"].tolist() == [0, 1, 2, 3]
+
+    with pytest.raises(ValueError):
+        plyr.unpack(bytes(8), layout)
@@ -0,0 +1,83 @@
+import ctypes
+from collections import namedtuple
+
+import numpy as np
+import pytest
+
+import plyr
+
+P = namedtuple("P", "x y z")
+S = [0, (0, {'a': 0})]
+
+
+class List(list):
+    pass
+
+
+@pytest.mark.parametrize('source', [
+    [1, 2, 3],
+    (1, 2, 3),
+    List([1, 2, 3]),
+    P(1, 2, 3),
+    plyr.AtomicList([1, 2, 3]),
+    plyr.AtomicTuple((1, 2, 3)),
+    iter([1, 2, 3]),
+    range(1, 4),
+])
+def test_unflatten_sequences(source):
+    assert plyr.unflatten(source, S) == [1, (2, {'a': 3})]
+
+
+@pytest.mark.parametrize('order', ['<', '>', '='])
+@pytest.mark.parametrize('dtype, values', [
+    ('i1', [1, -2, 3]),
+    ('u2', [1, 2, 65535]),
+    ('i4', [1, -2, 3]),
+    ('i8', [1, -2, 2**62]),
+    ('u8', [1, 2, 2**64 - 1]),
+    ('f4', [1.5, -2.0, 3.25]),
+    ('f8', [1.5, -2.0, 3.25]),
+    ('?', [True, False, True]),
+])
+def test_byte_ordered_formats(order, dtype, values):
+    # numpy exports e.g. `>i` or `<l` with the native size, unlike struct
+    source = np.array(values, dtype=np.dtype(order + dtype))
+    res = plyr.populate(S, source)
+    assert res == [values[0], (values[1], {'a': values[2]})]
+    assert type(res[0]) is type(values[0])
+
+
+def test_memoryview_rows_are_zero_copy():
+    a = np.arange(12.).reshape(3, 4)
+    res = plyr.populate(S, memoryview(a))
+    flat, _ = plyr.flatten(res)
+    assert [x.tolist() for x in flat] == a.tolist()
+
+    # the rows share the memory of the source
+    flat[1][2] = -1.
+    assert a[1, 2] == -1.
+
+    with pytest.raises(TypeError):
+        plyr.populate(S, memoryview(a[:, ::2]))
+
+
+def test_short_sources_raise_before_committing():
+    committed = []
+    for source in [[1, 2], np.arange(2)]:
+        with pytest.raises(StopIteration):
+            plyr.populate(S, source, _committer=committed.append)
+
+    assert committed == []
+    assert plyr.populate(S, [1, 2], default=None) == [1, (2, {'a': None})]
+
+
+@pytest.mark.parametrize('ctype, values', [
+    (ctypes.c_long, [1, -2, 3]),
+    (ctypes.c_ulong, [1, 2, 2**40]),
+    (ctypes.c_int16.__ctype_be__, [1, -2, 3]),
+    (ctypes.c_double.__ctype_be__, [1.5, -2.0, 3.25]),
+])
+def test_ctypes_formats(ctype, values):
+    # ctypes exports e.g. `<l` of 8 bytes on LP64
+    source = (ctype * 3)(*values)
+    assert plyr.populate(S, source) == [values[0], (values[1], {'a': values[2]})]
@@ -0,0 +1,43 @@
+import gc
+import weakref
+import numpy as np
+
+import plyr
+
+
+def test_ringbuffer_wraps_around():
+    rb = plyr.RingBuffer({'x': np.zeros(2, np.float32), 'n': 0}, 4)
+    for k in range(6):
+        rb.push({'x': np.full(2, k, np.float32), 'n': k})
+
+    assert len(rb) == 4 and rb.head == 2
+    res = rb.sample([0, 1, -1, -2])
+    assert np.array_equal(np.asarray(res['n']), [2, 3, 5, 4])
+    assert np.array_equal(np.asarray(res['x'])[:, 1], [2, 3, 5, 4])
+
+    # the columns are the slots of the storage
+    assert np.array_equal(np.asarray(rb.columns['n']), [4, 5, 2, 3])
+
+    # a batch larger than the capacity keeps its last rows
+    rb.extend({'x': np.zeros((7, 2), np.float32), 'n': np.arange(10, 17)})
+    assert np.array_equal(np.asarray(rb.sample(range(4))['n']), [13, 14, 15, 16])
+    assert np.asarray(rb.sample([-1])['n'])[0] == 16
+
+
+def test_ringbuffer_partially_filled():
+    rb = plyr.RingBuffer(np.zeros(3), 5)
+    rb.extend(np.arange(6.).reshape(2, 3))
+    assert np.array_equal(np.asarray(rb.sample([-1, 0])), [[3, 4, 5], [0, 1, 2]])
+
+
+def test_ringbuffer_collects_cycles():
+    class Key:
+        pass
+
+    # the ring buffer is reachable from the key in its own skeleton
+    key = Key()
+    rb = plyr.RingBuffer({key: np.zeros(2)}, 3)
+    key.rb, ref = rb, weakref.ref(key)
+    del key, rb
+    gc.collect()
+    assert ref() is None
@@ -0,0 +1,60 @@
+import ctypes
+import pytest
+import numpy as np
+
+from plyr import ops
+
+
+def test_take_gathers_rows():
+    x = {'a': np.arange(24.).reshape(6, 4), 'b': [np.arange(6, dtype=np.int8)]}
+    index = np.array([5, 0, -1, 2])
+
+    res = ops.take(x, index)
+    assert isinstance(res['a'], memoryview)
+    assert np.array_equal(res['a'], x['a'][index])
+    assert np.array_equal(res['b'][0], x['b'][0][index])
+
+    res = ops.take(x['a'], [3, 1], axis=1)
+    assert np.array_equal(res, x['a'][:, [3, 1]])
+
+
+def test_take_strided_buffers():
+    # the non-contiguous buffers also become memoryviews
+    x = np.arange(120.).reshape(4, 5, 6)
+    index = [4, 0, 0, 2]
+    for y in (x[::2], x[:, ::-2], x.transpose(2, 0, 1)):
+        for axis in range(3):
+            idx = [k % y.shape[axis] for k in index]
+            res = ops.take(y, idx, axis=axis)
+            assert isinstance(res, memoryview)
+            assert np.array_equal(res, np.take(y, idx, axis=axis))
+
+
+def test_take_committer():
+    x = [np.arange(10.), np.arange(20).reshape(10, 2)[::2]]
+    res = ops.take(x, [1, 3], committer=np.asarray)
+    assert all(isinstance(r, np.ndarray) for r in res)
+    assert np.array_equal(res[0], [1., 3.])
+    assert np.array_equal(res[1], [[4, 5], [12, 13]])
+
+    # the committer gets the complete data even if it copies
+    res = ops.take(x, [1, 3], committer=bytes)
+    assert res[0] == np.array([1., 3.]).tobytes()
+
+    with pytest.raises(TypeError, match='callable'):
+        ops.take(x, [1], committer=1)
+
+
+def test_take_indices():
+    x = np.arange(10)
+    index = (ctypes.c_int64 * 3)(9, 0, -2)
+    assert np.array_equal(ops.take(x, index), [9, 0, 8])
+
+    with pytest.raises(IndexError):
+        ops.take(x, np.array([2**63 + 1], np.uint64))
+
+    with pytest.raises(IndexError):
+        ops.take(x, [10])
+
+    with pytest.raises(TypeError):
+        ops.take(x, np.array([1.]))
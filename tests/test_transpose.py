@@ -0,0 +1,46 @@
+from collections import namedtuple
+
+import pytest
+import numpy as np
+
+import plyr
+
+
+P = namedtuple("P", "x y")
+
+
+def test_transpose_roundtrip():
+    results = [{"a": k, "b": P(k, [2 * k, None])} for k in range(5)]
+    res = plyr.transpose(results)
+    assert res == plyr.apply(lambda *a: list(a), *results)
+    assert isinstance(res["a"], plyr.AtomicList) and type(res["b"]) is P
+
+    # the atomic lists are the leaves of the transposed object
+    assert plyr.untranspose(res) == results
+    assert plyr.transpose(iter(results)) == res
+    assert plyr.transpose([0, 1]) == [0, 1]
+
+
+def test_transpose_arrays():
+    results = [{"x": np.full(3, k), "y": (k,)} for k in range(4)]
+    res = plyr.apply(np.stack, plyr.transpose(results), axis=0)
+    assert np.array_equal(
+        res["x"], plyr.apply(np.stack, *results, _star=False, axis=0)["x"])
+
+    back = plyr.untranspose(res)
+    assert len(back) == 4
+    assert all(np.array_equal(b["x"], r["x"]) for b, r in zip(back, results))
+    assert [b["y"][0] for b in back] == [0, 1, 2, 3]
+
+
+def test_transpose_errors():
+    with pytest.raises(ValueError):
+        plyr.transpose([])
+
+    with pytest.raises(KeyError):
+        plyr.transpose([{"a": 1}, {"b": 1}])
+
+    with pytest.raises(ValueError, match="same length"):
+        plyr.untranspose({"a": plyr.AtomicList([1, 2]), "b": plyr.AtomicList([1])})
+
+    assert plyr.untranspose({}) == []
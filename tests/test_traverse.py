@@ -0,0 +1,57 @@
+import pytest
+
+import plyr
+
+
+def nest(depth, leaf=0, container=list):
+    obj = leaf
+    for _ in range(depth):
+        obj = container([obj])
+    return obj
+
+
+@pytest.mark.parametrize('depth', [1, 63, 64, 65, 200, 100000])
+def test_deep_nesting(depth):
+    # the depth is limited by the heap only, and crosses the cycle depth
+    obj = nest(depth)
+    res = plyr.apply(lambda x: x + 1, obj)
+    flat, _ = plyr.flatten(res)
+    assert flat == [1]
+
+    assert plyr.validate(obj, nest(depth)) == []
+
+
+def test_shared_subtrees_are_not_cycles():
+    # the same container may appear many times, but not on the same path
+    shared = nest(100)
+    obj = [shared, {'a': shared, 'b': (shared, shared)}]
+    flat, _ = plyr.flatten(obj)
+    assert flat == [0] * 4
+
+    assert plyr.TreeDef(obj).num_leaves == 4
+
+
+def self_referencing_list():
+    a = [1, 2]
+    a.append(a)
+    return a
+
+
+def self_referencing_dict():
+    d = {'a': 1}
+    d['b'] = [{'c': d}]
+    return d
+
+
+@pytest.mark.parametrize('make', [self_referencing_list, self_referencing_dict])
+@pytest.mark.parametrize('fn', [
+    lambda obj: plyr.apply(str, obj),
+    lambda obj: plyr.apply(str, obj, _cache=True),
+    lambda obj: plyr.flatten(obj),
+    lambda obj: plyr.validate(obj, obj),
+    lambda obj: plyr.TreeDef(obj),
+    lambda obj: plyr.reduce(lambda x, y: x, obj),
+])
+def test_cycles_raise(make, fn):
+    with pytest.raises(RecursionError):
+        fn(make())
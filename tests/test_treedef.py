@@ -0,0 +1,59 @@
+import gc
+import weakref
+import pytest
+from collections import namedtuple
+
+import plyr
+
+
+P = namedtuple('P', 'x y')
+
+
+STRUCTS = [
+    1,
+    [],
+    (1, [2, 3], {'a': 4, 'b': (5,)}),
+    {'p': P(1, [2, P(3, 4.)]), 'e': {}, 'l': [P(5, None)]},
+]
+
+
+@pytest.mark.parametrize('struct', STRUCTS)
+def test_treedef_roundtrip(struct):
+    td = plyr.TreeDef(struct)
+    leaves = td.flatten(struct)
+    assert len(leaves) == td.num_leaves
+    assert td.unflatten(leaves) == struct
+    assert td.unflatten(map(str, leaves)) == plyr.apply(str, struct)
+
+    with pytest.raises(RuntimeError):
+        td.unflatten(leaves + [None])
+
+
+def test_treedef_equality_and_hash():
+    a = plyr.TreeDef({'a': [1, 2], 'b': P(3, 4)})
+    b = plyr.TreeDef({'a': ['x', 'y'], 'b': P(None, 0)})
+    assert a == b and not a != b
+    assert hash(a) == hash(b)
+    assert {a: 1}[b] == 1
+
+    # keys by value, the types by identity, and the sizes
+    assert plyr.TreeDef({1: 0}) == plyr.TreeDef({1.0: 0})
+    assert hash(plyr.TreeDef({1: 0})) == hash(plyr.TreeDef({1.0: 0}))
+    assert a != plyr.TreeDef({'a': [1, 2], 'c': P(3, 4)})
+    assert a != plyr.TreeDef({'a': (1, 2), 'b': P(3, 4)})
+    assert a != plyr.TreeDef({'a': [1, 2, 3], 'b': P(3, 4)})
+    assert a != plyr.TreeDef({'a': [1, 2], 'b': (3, 4)})
+    assert plyr.TreeDef([1]) != plyr.TreeDef([1], _strict=False)
+    assert len({a, b, plyr.TreeDef([1]), plyr.TreeDef([2])}) == 2
+
+
+def test_treedef_collects_cycles():
+    class Key:
+        pass
+
+    # the structure is reachable from a key of its own dict
+    key = Key()
+    key.td, ref = plyr.TreeDef({key: 1}), weakref.ref(key)
+    del key
+    gc.collect()
+    assert ref() is None
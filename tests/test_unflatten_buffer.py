@@ -0,0 +1,39 @@
+import pytest
+import numpy as np
+
+import plyr
+
+
+def test_unflatten_buffer_views():
+    vector = np.arange(11.)
+    shapes = {"w": np.zeros((2, 3)), "b": [2], "s": (3,)}
+    out = plyr.unflatten_buffer(vector, shapes)
+    assert np.array_equal(out["w"], vector[:6].reshape(2, 3))
+    assert np.array_equal(out["b"][0], vector[6:8])
+    assert np.array_equal(out["s"][0], vector[8:])
+
+    # the views are zero-copy and writable
+    np.asarray(out["w"])[:] = -1
+    assert np.all(vector[:6] == -1)
+
+    # a shape may be a sequence of ints, which is not a nested container
+    class Size(tuple):
+        pass
+
+    out = plyr.unflatten_buffer(vector[:6], [Size((3, 2))])
+    assert out[0].shape == (3, 2)
+
+    out = plyr.unflatten_buffer(bytes(vector), {"a": 88})
+    assert out["a"].readonly and out["a"].format == "B"
+
+
+def test_unflatten_buffer_errors():
+    shapes = {"a": np.zeros((2, 3)), "b": [2]}
+    with pytest.raises(ValueError, match="too short"):
+        plyr.unflatten_buffer(np.arange(7.), shapes)
+
+    with pytest.raises(ValueError, match="take"):
+        plyr.unflatten_buffer(np.arange(9.), shapes)
+
+    with pytest.raises(ValueError, match="C-contiguous"):
+        plyr.unflatten_buffer(np.arange(16.)[::2], shapes)